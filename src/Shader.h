@@ -5,118 +5,214 @@
 #include <glad/glad.h>
 
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
+#include <unordered_map>
+
+#include "program_cache.hpp"
+#include "shader_source.hpp"
 
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly; paths are names known
+    // to shader_source, e.g. "shader.vert"
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
+        : ID(0), pending(0), vertexPath(vertexPath), fragmentPath(fragmentPath)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
+        // 1. retrieve the vertex/fragment source code
         std::string vertexCode;
         std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+        if (!readSources(vertexCode, fragmentCode))
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << fragmentPath << std::endl;
+        }
+        // 2. link from the program cache, or compile and link the sources
+        unsigned int program = glCreateProgram();
+        uint64_t key = program_cache_key(vertexCode, fragmentCode);
+        if (!program_cache_load(program, key))
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode   = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            compile(program, vertexCode, fragmentCode);
+            if (checkCompileErrors(program, "PROGRAM"))
+                program_cache_store(program, key);
         }
-        catch (std::ifstream::failure& e)
+        ID = program;
+        cacheUniforms();
+    }
+    // activate the shader
+    // ------------------------------------------------------------------------
+    void use()
+    {
+        glUseProgram(ID);
+    }
+    // true if this shader was built from the given file
+    // ------------------------------------------------------------------------
+    bool uses(const std::string &path) const
+    {
+        return path == vertexPath || path == fragmentPath;
+    }
+    // start rebuilding from the sources again; the current program stays in
+    // use until poll_reload() finds the new one linked
+    // ------------------------------------------------------------------------
+    void reload()
+    {
+        std::string vertexCode;
+        std::string fragmentCode;
+        if (!readSources(vertexCode, fragmentCode))
+            return;
+        if (pending)
+            glDeleteProgram(pending);
+        pending = glCreateProgram();
+        pendingKey = program_cache_key(vertexCode, fragmentCode);
+        compile(pending, vertexCode, fragmentCode);
+    }
+    // swap in a reloaded program once the driver has finished linking it
+    // ------------------------------------------------------------------------
+    bool poll_reload()
+    {
+        if (!pending || !program_link_done(pending))
+            return false;
+        unsigned int program = pending;
+        pending = 0;
+        if (!checkCompileErrors(program, "PROGRAM"))
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            // keep running the old program until the shader is fixed
+            glDeleteProgram(program);
+            return false;
         }
+        program_cache_store(program, pendingKey);
+        glDeleteProgram(ID);
+        ID = program;
+        cacheUniforms();
+        std::cout << "reloaded " << fragmentPath << std::endl;
+        return true;
+    }
+    // location of a uniform, looked up once after linking; -1 if unused
+    // ------------------------------------------------------------------------
+    int location(const std::string &name) const
+    {
+        std::unordered_map<std::string, int>::const_iterator it = uniformLocations.find(name);
+        return it == uniformLocations.end() ? -1 : it->second;
+    }
+    // utility uniform functions
+    // ------------------------------------------------------------------------
+    void setBool(const std::string &name, bool value) const
+    {
+        glUniform1i(location(name), (int)value);
+    }
+    // ------------------------------------------------------------------------
+    void setInt(const std::string &name, int value) const
+    {
+        glUniform1i(location(name), value);
+    }
+    // ------------------------------------------------------------------------
+    void setFloat(const std::string &name, float value) const
+    {
+        glUniform1f(location(name), value);
+    }
+    // ------------------------------------------------------------------------
+    void setVec2(const std::string &name, float x, float y) const
+    {
+        glUniform2f(location(name), x, y);
+    }
+    // ------------------------------------------------------------------------
+    void setVec3(const std::string &name, float x, float y, float z) const
+    {
+        glUniform3f(location(name), x, y, z);
+    }
+    // ------------------------------------------------------------------------
+    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    {
+        glUniform4f(location(name), x, y, z, w);
+    }
+
+private:
+    unsigned int pending;       // program being rebuilt by reload()
+    uint64_t pendingKey;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::unordered_map<std::string, int> uniformLocations;
+
+    // read both sources, embedded or from the override directory
+    // ------------------------------------------------------------------------
+    bool readSources(std::string &vertexCode, std::string &fragmentCode)
+    {
+        return shader_source_read(vertexPath, vertexCode) &&
+               shader_source_read(fragmentPath, fragmentCode);
+    }
+    // compile both stages and start linking them into program
+    // ------------------------------------------------------------------------
+    void compile(unsigned int program, const std::string &vertexCode, const std::string &fragmentCode)
+    {
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
         unsigned int vertex, fragment;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
         glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
         // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        program_cache_prepare(program);
+        glLinkProgram(program);
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
     }
-    // activate the shader
-    // ------------------------------------------------------------------------
-    void use() 
-    { 
-        glUseProgram(ID); 
-    }
-    // utility uniform functions
-    // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
-    {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
-    }
+    // look up every active uniform once so set* never query the driver
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
-    { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
-    }
-    // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
-    { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    void cacheUniforms()
+    {
+        uniformLocations.clear();
+        int count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        for (int i = 0; i < count; i++)
+        {
+            char name[256];
+            int length = 0, size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, sizeof(name), &length, &size, &type, name);
+            std::string uniform(name, length);
+            // arrays are reported as "name[0]"
+            if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+                uniform.erase(uniform.size() - 3);
+            uniformLocations[uniform] = glGetUniformLocation(ID, uniform.c_str());
+        }
     }
-
-private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(unsigned int shader, std::string type)
+    bool checkCompileErrors(unsigned int program, std::string type)
     {
         int success;
         char infoLog[1024];
-        if (type != "PROGRAM")
-        {
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-            if (!success)
-            {
-                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
-        }
-        else
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
         {
-            glGetProgramiv(shader, GL_LINK_STATUS, &success);
-            if (!success)
+            // shaders flagged for deletion live on while attached, so their logs are still readable
+            unsigned int shaders[2];
+            int attached = 0;
+            glGetAttachedShaders(program, 2, &attached, shaders);
+            for (int i = 0; i < attached; i++)
             {
-                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                int compiled, stage;
+                glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+                glGetShaderiv(shaders[i], GL_SHADER_TYPE, &stage);
+                if (!compiled)
+                {
+                    glGetShaderInfoLog(shaders[i], 1024, NULL, infoLog);
+                    std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << (stage == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT") << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                }
             }
+            glGetProgramInfoLog(program, 1024, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << " (" << fragmentPath << ")\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
+        return success != 0;
     }
 };
-#endif
\ No newline at end of file
+#endif
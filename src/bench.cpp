@@ -0,0 +1,417 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chip8.hpp"
+#include "rom_gen.hpp"
+#include "soft_raster.hpp"
+
+// microbenchmarks of every OP_* handler and of fetch/decode/dispatch, plus
+// frames and instructions per second over a ROM corpus and generated stress
+// ROMs. Results go to JSON
+// and are compared against a baseline from an earlier run:
+//   chip8-bench [--output <json>] [--baseline <json>] [--threshold <percent>] [--roms <file>...]
+#define BENCH_REPEATS 9                 // median of, so a few disturbed runs do not move it
+#define BENCH_MIN_SECONDS 0.04          // per repeat
+#define BENCH_CHUNK 4096                // instructions between clock reads
+#define BENCH_BODY 256                  // copies of the measured instruction per loop
+#define BENCH_CYCLES_PER_FRAME 10       // as chip8-headless
+#define BENCH_DEFAULT_THRESHOLD 50.0    // percent slower than the baseline that fails
+
+typedef std::chrono::steady_clock Clock;
+typedef std::vector<uint8_t> Rom;
+
+struct Workload
+{
+    std::string name;
+    Rom rom;
+    unsigned long restart;              // instructions until it stops, 0 if it never does
+};
+
+struct Micro
+{
+    const char *name;
+    std::vector<uint16_t> setup;        // run once before the loop
+    uint16_t body;                      // repeated BENCH_BODY times, then jump back
+};
+
+// registers start at 0; V1 = 1 and key 1 is held so no instruction skips or
+// waits, I points at free memory unless setup moves it
+static const Micro micros[] = {
+    { "dispatch", {}, 0xE000 },         // no handler: fetch, decode and the timers alone
+    { "00E0", {}, 0x00E0 },
+    { "2NNN+00EE", {}, 0x2000 },        // call into a return, address filled in below
+    { "1NNN", {}, 0x1000 },             // jump to itself, address filled in below
+    { "3XNN", {}, 0x3001 },
+    { "4XNN", {}, 0x4000 },
+    { "5XY0", {}, 0x5010 },
+    { "6XNN", {}, 0x6212 },
+    { "7XNN", {}, 0x7201 },
+    { "8XY0", {}, 0x8210 },
+    { "8XY1", {}, 0x8211 },
+    { "8XY2", {}, 0x8212 },
+    { "8XY3", {}, 0x8213 },
+    { "8XY4", {}, 0x8214 },
+    { "8XY5", {}, 0x8215 },
+    { "8XY6", {}, 0x8216 },
+    { "8XY7", {}, 0x8217 },
+    { "8XYE", {}, 0x821E },
+    { "9XY0", {}, 0x9020 },
+    { "ANNN", {}, 0xAE00 },
+    { "BNNN", {}, 0xB000 },             // jump to itself plus V0, address filled in below
+    { "CXNN", {}, 0xC2FF },
+    { "DXYN", { 0xA050 }, 0xD005 },     // a font digit at 0,0
+    { "EX9E", {}, 0xE09E },
+    { "EXA1", {}, 0xE1A1 },
+    { "FX07", {}, 0xF207 },
+    { "FX0A", {}, 0xF20A },
+    { "FX15", {}, 0xF015 },
+    { "FX18", {}, 0xF018 },
+    { "FX1E", {}, 0xF01E },
+    { "FX29", {}, 0xF229 },
+    { "FX33", {}, 0xF133 },
+    { "FX55", {}, 0xFF55 },
+    { "FX65", {}, 0xF065 },             // loads V0 only, so V1 stays 1
+};
+
+// small programs that keep running forever without input
+static const std::pair<const char*, Rom> corpus[] = {
+    // BCD of a counter drawn as three font digits, every frame cleared
+    { "counter", {
+        0x00, 0xE0,     // 200 CLS
+        0xA3, 0x00,     // 202 I = 300
+        0xF3, 0x33,     // 204 BCD V3
+        0xF2, 0x65,     // 206 V0..V2 = [I]
+        0x64, 0x10,     // 208 V4 = 16
+        0x65, 0x0A,     // 20A V5 = 10
+        0xF0, 0x29,     // 20C I = digit V0
+        0xD4, 0x55,     // 20E draw
+        0x74, 0x05,     // 210 V4 += 5
+        0xF1, 0x29,     // 212 I = digit V1
+        0xD4, 0x55,     // 214 draw
+        0x74, 0x05,     // 216 V4 += 5
+        0xF2, 0x29,     // 218 I = digit V2
+        0xD4, 0x55,     // 21A draw
+        0x73, 0x01,     // 21C V3 += 1
+        0x12, 0x00,     // 21E jump 200
+    } },
+    // an 8x8 box moving diagonally, drawn and erased
+    { "bounce", {
+        0x6A, 0x37,     // 200 VA = 37, keeps x + 8 on screen
+        0x6B, 0x17,     // 202 VB = 17, keeps y + 8 on screen
+        0xA2, 0x1A,     // 204 I = box
+        0x82, 0x00,     // 206 V2 = V0
+        0x82, 0xA2,     // 208 V2 &= VA
+        0x83, 0x10,     // 20A V3 = V1
+        0x83, 0xB2,     // 20C V3 &= VB
+        0xD2, 0x38,     // 20E draw
+        0xD2, 0x38,     // 210 erase
+        0x70, 0x01,     // 212 V0 += 1
+        0x71, 0x03,     // 214 V1 += 3
+        0x12, 0x06,     // 216 jump 206
+        0x00, 0x00,     // 218
+        0xFF, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0xFF,     // 21A box
+    } },
+    // arithmetic, skips and a subroutine, no drawing
+    { "arith", {
+        0x60, 0x01,     // 200 V0 = 1
+        0x61, 0x03,     // 202 V1 = 3
+        0x80, 0x14,     // 204 V0 += V1
+        0x81, 0x05,     // 206 V1 -= V0
+        0x82, 0x0E,     // 208 V2 = V0 << 1
+        0x30, 0x00,     // 20A skip if V0 == 0
+        0x22, 0x14,     // 20C call 214
+        0x72, 0x01,     // 20E V2 += 1
+        0x12, 0x04,     // 210 jump 204
+        0x00, 0x00,     // 212
+        0x83, 0x03,     // 214 V3 ^= V0
+        0x84, 0x26,     // 216 V4 = V2 >> 1
+        0x00, 0xEE,     // 218 return
+    } },
+};
+
+// generated stress ROMs, each large enough to run a while before it stops
+static const RomSpec generated[] = {
+    { "draw", 65025, 16, 15, 1 },
+    { "branch", 65025, 600, 1, 1 },
+    { "calls", 100, 3, 8, 1 },
+    { "memory", 65025, 32, 8, 1 },
+    { "selfmod", 65025, 12, 1, 1 },
+};
+
+static void put(Rom &rom, uint16_t opcode)
+{
+    rom.push_back(opcode >> 8);
+    rom.push_back(opcode & 0xFF);
+}
+
+static Rom micro_rom(const Micro &micro)
+{
+    Rom rom;
+    put(rom, 0x6101);
+    put(rom, 0xAE00);
+    for (uint16_t opcode : micro.setup)
+        put(rom, opcode);
+    uint16_t loop = 0x200 + rom.size();
+    uint16_t body = micro.body;
+    if (body == 0x1000 || body == 0xB000)
+    {
+        put(rom, body | loop);
+        return rom;
+    }
+    // the subroutine follows the jump back
+    uint16_t subroutine = loop + BENCH_BODY * 2 + 2;
+    if (body == 0x2000)
+        body |= subroutine;
+    for (int i = 0; i < BENCH_BODY; i++)
+        put(rom, body);
+    put(rom, 0x1000 | loop);
+    put(rom, 0x00EE);
+    return rom;
+}
+
+static Chip8* boot(const Rom &rom)
+{
+    Chip8 *chip8 = new Chip8();
+    chip8->load(rom.data(), rom.size());
+    chip8->key[1] = 1;
+    return chip8;
+}
+
+// the middle one; best-of only tracks the luckiest run and swings with it
+static double median(std::vector<double> samples)
+{
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+// nanoseconds per instruction over one BENCH_MIN_SECONDS run
+static double time_instructions(const Rom &rom, unsigned long restart = 0)
+{
+    Chip8 *chip8 = boot(rom);
+    unsigned long cycles = 0, booted = 0;
+    double seconds = 0;
+    Clock::time_point start = Clock::now();
+    while (seconds < BENCH_MIN_SECONDS)
+    {
+        // a stopped ROM would only time its final jump
+        if (restart && cycles + BENCH_CHUNK - booted > restart)
+        {
+            delete chip8;
+            chip8 = boot(rom);
+            booted = cycles;
+        }
+        for (int i = 0; i < BENCH_CHUNK; i++)
+            chip8->cycle();
+        cycles += BENCH_CHUNK;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    delete chip8;
+    return seconds * 1e9 / cycles;
+}
+
+// 60 Hz frames per second as chip8-headless runs them, without the encoder:
+// a batch of instructions, then the software rasterizer when the screen changed
+static double time_frames(const Rom &rom, unsigned long restart)
+{
+    SoftRaster raster;
+    raster.init(VIDEO_WIDTH, VIDEO_HEIGHT, 1);
+    uint8_t screen[VIDEO_WIDTH * VIDEO_HEIGHT];
+    Chip8 *chip8 = boot(rom);
+    unsigned long frames = 0, booted = 0;
+    double seconds = 0;
+    Clock::time_point start = Clock::now();
+    while (seconds < BENCH_MIN_SECONDS)
+    {
+        if (restart && (frames + 64 - booted) * BENCH_CYCLES_PER_FRAME > restart)
+        {
+            delete chip8;
+            chip8 = boot(rom);
+            booted = frames;
+        }
+        for (int frame = 0; frame < 64; frame++)
+        {
+            for (int i = 0; i < BENCH_CYCLES_PER_FRAME; i++)
+                chip8->cycle();
+            if (chip8->draw_flag)
+            {
+                chip8->draw_flag = false;
+                chip8->expand_screen(screen);
+                raster.render(screen, 1.0f / 60);
+            }
+        }
+        frames += 64;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    delete chip8;
+    return frames / seconds;
+}
+
+static bool read_file(const char *path, Rom &rom)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// the flat objects this tool writes: "key": number per line
+static bool read_results(const char *path, std::map<std::string, double> &results)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t open = line.find('"');
+        size_t close = line.find('"', open + 1);
+        size_t colon = line.find(':', close);
+        if (open == std::string::npos || close == std::string::npos || colon == std::string::npos)
+            continue;
+        results[line.substr(open + 1, close - open - 1)] = std::atof(line.c_str() + colon + 1);
+    }
+    return true;
+}
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --output <json>     write the results here (default bench.json)\n"
+              << "  --baseline <json>   compare against an earlier run, exit 1 on a regression\n"
+              << "  --threshold <pct>   slowdown against the baseline that counts as a regression (default "
+              << BENCH_DEFAULT_THRESHOLD << ")\n"
+              << "  --roms <file>...    add ROM files to the throughput corpus\n";
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+    const char *outputPath = "bench.json";
+    const char *baselinePath = nullptr;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    std::vector<Workload> roms;
+    for (const auto &rom : corpus)
+        roms.push_back(Workload{ rom.first, rom.second, 0 });
+    for (const RomSpec &spec : generated)
+    {
+        GeneratedRom rom;
+        if (!generate_rom(spec, rom))
+            return EXIT_FAILURE;
+        roms.push_back(Workload{ "gen-" + spec.kind, rom.rom, rom.cycles });
+    }
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--output") == 0 && hasValue)
+            outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue)
+            baselinePath = argv[++i];
+        else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue)
+            threshold = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--roms") == 0)
+        {
+            while (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0)
+            {
+                const char *path = argv[++i];
+                Rom rom;
+                if (!read_file(path, rom))
+                {
+                    std::cerr << "Cannot read " << path << "\n";
+                    std::exit(EXIT_FAILURE);
+                }
+                const char *slash = std::strrchr(path, '/');
+                roms.push_back(Workload{ slash ? slash + 1 : path, rom, 0 });
+            }
+        }
+        else
+            usage(argv[0]);
+    }
+
+    // every benchmark runs once per round and reports the median over the
+    // rounds, so a slow stretch of the machine costs each of them one sample
+    // instead of a whole benchmark all of its runs
+    const size_t microCount = sizeof(micros) / sizeof(micros[0]);
+    std::vector<Rom> microRoms;
+    for (const Micro &micro : micros)
+        microRoms.push_back(micro_rom(micro));
+    std::vector<std::vector<double>> microSamples(microCount), instructionSamples(roms.size()), frameSamples(roms.size());
+    for (int round = 0; round < BENCH_REPEATS; round++)
+    {
+        for (size_t i = 0; i < microCount; i++)
+            microSamples[i].push_back(time_instructions(microRoms[i]));
+        for (size_t i = 0; i < roms.size(); i++)
+        {
+            instructionSamples[i].push_back(1e9 / time_instructions(roms[i].rom, roms[i].restart));
+            frameSamples[i].push_back(time_frames(roms[i].rom, roms[i].restart));
+        }
+    }
+
+    // ordered as printed; names ending in _per_sec are better when higher
+    std::vector<std::pair<std::string, double>> results;
+    std::cout << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < microCount; i++)
+    {
+        double ns = median(microSamples[i]);
+        results.push_back(std::make_pair(std::string("micro.") + micros[i].name + ".ns_per_instruction", ns));
+        std::cout << "  " << std::setw(12) << std::left << micros[i].name << std::right << std::setw(10) << ns << " ns\n";
+    }
+    for (size_t i = 0; i < roms.size(); i++)
+    {
+        double instructions = median(instructionSamples[i]);
+        double frames = median(frameSamples[i]);
+        results.push_back(std::make_pair("throughput." + roms[i].name + ".instructions_per_sec", instructions));
+        results.push_back(std::make_pair("throughput." + roms[i].name + ".frames_per_sec", frames));
+        std::cout << "  " << std::setw(12) << std::left << roms[i].name << std::right << std::setw(14) << instructions / 1e6
+                  << " M instructions/s" << std::setw(12) << frames << " frames/s\n";
+    }
+
+    std::ofstream output(outputPath);
+    output << std::setprecision(6) << "{";
+    for (size_t i = 0; i < results.size(); i++)
+        output << (i ? ",\n" : "\n") << "  \"" << results[i].first << "\": " << results[i].second;
+    output << "\n}\n";
+    if (!output)
+    {
+        std::cerr << "ERROR::BENCH::WRITE_FAILED " << outputPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!baselinePath)
+        return 0;
+    std::map<std::string, double> baseline;
+    if (!read_results(baselinePath, baseline))
+    {
+        std::cerr << "ERROR::BENCH::BASELINE_NOT_READ " << baselinePath << std::endl;
+        return EXIT_FAILURE;
+    }
+    int regressions = 0;
+    for (const auto &result : results)
+    {
+        auto old = baseline.find(result.first);
+        if (old == baseline.end() || old->second <= 0 || result.second <= 0)
+            continue;
+        bool higherIsBetter = result.first.size() > 8 && result.first.compare(result.first.size() - 8, 8, "_per_sec") == 0;
+        double slowdown = higherIsBetter ? old->second / result.second : result.second / old->second;
+        double percent = (slowdown - 1.0) * 100.0;
+        if (percent > threshold)
+        {
+            std::cout << "REGRESSION " << result.first << ": " << old->second << " -> " << result.second
+                      << " (" << percent << "% slower)\n";
+            regressions++;
+        }
+    }
+    std::cout << regressions << " regressions over " << threshold << "% against " << baselinePath << "\n";
+    return regressions ? EXIT_FAILURE : 0;
+}
@@ -1,3 +1,4 @@
+#include <cassert>
 #include <cstdlib>
 #include <fstream>
 #include <chrono>
@@ -6,14 +7,18 @@
 #include <time.h>
 
 #include "chip8.hpp"
+#include "memory_heat.hpp"
+#include "trace.hpp"
 
 #define MEMORY_START 0x200
 #define FONT_SIZE 80
 #define FONT_START_ADDRESS 0x50
 
+constexpr StateHashKeys state_hash_keys;
+
 Chip8::Chip8(){
     // seed random number generator
-    srand(time(NULL));
+    seed((uint32_t)time(NULL));
 
     pc = MEMORY_START;     // first address to be executed
 
@@ -21,6 +26,7 @@ Chip8::Chip8(){
     for(int i = 0; i < FONT_SIZE; i++){
         memory[FONT_START_ADDRESS + i] = fontset[i];
     }
+    rehash();
 }
 
 void Chip8::loadROM(const char *filename){
@@ -40,19 +46,45 @@ void Chip8::loadROM(const char *filename){
 		file.read(buffer, size);
 		file.close();
 
-		// Load the ROM contents into the Chip8's memory, starting at 0x200
-		for (long i = 0; i < size; ++i){
-			memory[0x200 + i] = buffer[i];
-	    }
+		// Load the ROM contents into the Chip8's memory, starting at 0x200;
+		// whatever does not fit below 0x1000 is dropped
+		if(size > (std::streampos)(sizeof(memory) - MEMORY_START)){
+			std::cerr << "ROM is " << size << " bytes, only the first " << sizeof(memory) - MEMORY_START << " fit in memory\n";
+		}
+		load((const uint8_t*)buffer, size);
 
 		// Free the buffer
 		delete[] buffer;
     }
 }
 
-void Chip8::cycle(){
-    //fetch instructions
-    opcode = (memory[pc] << 8) | memory[pc + 1];
+// ROMs built in memory, by benchmarks and generators
+void Chip8::load(const uint8_t *rom, size_t size){
+    if(size > sizeof(memory) - MEMORY_START){
+        size = sizeof(memory) - MEMORY_START;
+    }
+    std::memcpy(memory + MEMORY_START, rom, size);
+    rehash();
+}
+
+void Chip8::rehash(){
+    memory_sum = 0;
+    for(int i = 0; i < 4096; i++){
+        memory_sum += memory_delta(i, 0, memory[i]);
+    }
+    screen_zobrist = 0;
+    for(int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++){
+        if(screen[i]){
+            screen_zobrist ^= pixel_key(i);
+        }
+    }
+}
+
+template<typename Profiler>
+void Chip8::step(Profiler &profiler){
+    //fetch instructions; addresses wrap at 4 KB like the 12 bit bus
+    opcode = (memory[pc & 0xFFF] << 8) | memory[(pc + 1) & 0xFFF];
+    profiler.instruction(pc, opcode, I);
 
     // increment program counter
     pc += 2;
@@ -74,6 +106,9 @@ void Chip8::cycle(){
                 case 0x00EE:
                     OP_00EE();
                     break;
+                default:
+                    invalid_opcodes++;
+                    break;
             }
             break;
         case 0x1000:
@@ -126,8 +161,14 @@ void Chip8::cycle(){
                 case 0x0E:
                     OP_8XYE();
                     break;
+                default:
+                    invalid_opcodes++;
+                    break;
             }
             break;
+        case 0x9000:
+            OP_9XY0();
+            break;
         case 0xA000:
             OP_ANNN();
             break;
@@ -148,6 +189,9 @@ void Chip8::cycle(){
                 case 0x01:
                     OP_EXA1();
                     break;
+                default:
+                    invalid_opcodes++;
+                    break;
             }
             break;
         case 0xF000:
@@ -188,7 +232,14 @@ void Chip8::cycle(){
                     OP_FX65();
                     break;
                 }
+                default:
+                    invalid_opcodes++;
+                    break;
             }
+            break;
+        default:
+            invalid_opcodes++;
+            break;
     }
 
     // Decrement the delay timer if it's been set
@@ -203,18 +254,81 @@ void Chip8::cycle(){
 
 }
 
+// the policies frontends can run step() with
+template void Chip8::step<NoProfile>(NoProfile&);
+template void Chip8::step<OpcodeProfile>(OpcodeProfile&);
+template void Chip8::step<MemoryHeat>(MemoryHeat&);
+template void Chip8::step<ProfilePair<OpcodeProfile, MemoryHeat>>(ProfilePair<OpcodeProfile, MemoryHeat>&);
+template void Chip8::step<TraceDrawBursts>(TraceDrawBursts&);
+template void Chip8::step<ProfilePair<OpcodeProfile, TraceDrawBursts>>(ProfilePair<OpcodeProfile, TraceDrawBursts>&);
+
+void Chip8::expand_screen(uint8_t *dst) const{
+    // pixels are either 0 or 0xFFFFFFFF, keep the low byte
+    for(int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++){
+        dst[i] = (uint8_t)screen[i];
+    }
+}
+
+Chip8State Chip8::state() const{
+    Chip8State state;
+    std::memcpy(state.memory, memory, sizeof(memory));
+    std::memcpy(state.registers, registers, sizeof(registers));
+    state.I = I;
+    state.pc = pc;
+    std::memcpy(state.stack, stack, sizeof(stack));
+    state.sp = sp;
+    state.delay_timer = delay_timer;
+    state.sound_timer = sound_timer;
+    state.rng = rng;
+    std::memcpy(state.screen, screen, sizeof(screen));
+    return state;
+}
+
+void Chip8::restore(const Chip8State &state){
+    copy_in(state);
+    rehash();
+}
+
+void Chip8::restore(const Chip8State &state, uint64_t memory_known, uint64_t screen_known){
+    copy_in(state);
+#ifdef CHIP8_CHECK_HASHES
+    // hashes handed in from elsewhere must describe this state
+    rehash();
+    assert(memory_sum == memory_known && "restore() given a memory hash of another state");
+    assert(screen_zobrist == screen_known && "restore() given a screen hash of another state");
+#endif
+    memory_sum = memory_known;
+    screen_zobrist = screen_known;
+}
+
+void Chip8::copy_in(const Chip8State &state){
+    std::memcpy(memory, state.memory, sizeof(memory));
+    std::memcpy(registers, state.registers, sizeof(registers));
+    I = state.I;
+    pc = state.pc;
+    std::memcpy(stack, state.stack, sizeof(stack));
+    sp = state.sp;
+    delay_timer = state.delay_timer;
+    sound_timer = state.sound_timer;
+    rng = state.rng;
+    std::memcpy(screen, state.screen, sizeof(screen));
+    draw_flag = true;
+}
+
 /* opcodes */
 // clear
 void Chip8::OP_00E0(){
 
     // set pixels to 0
     std::memset(screen, 0, sizeof(screen));
+    screen_zobrist = 0;
+    draw_flag = true;
 }
 
 // return from subroutine
 void Chip8::OP_00EE(){
-    // decrement stack pointer
-    sp--;
+    // decrement stack pointer, a return without a call wraps around
+    sp = (sp - 1) & 0xF;
 
     // pop topmost address off stack and put in program counter
     pc = stack[sp];
@@ -233,8 +347,8 @@ void Chip8::OP_2NNN(){
     uint16_t addr = opcode & 0x0FFF;
     // place current pc on top of stack
     stack[sp] = pc;
-    // increment stack pointer
-    sp++;
+    // increment stack pointer, the 17th nested call overwrites the first
+    sp = (sp + 1) & 0xF;
     // set pc to subroutine address
     pc = addr;
 }
@@ -443,14 +557,18 @@ void Chip8::OP_BNNN(){
     pc = registers[0x00] + NNN;
 }
 
-// set VX = rand() & NN
+// set VX = random & NN
 void Chip8::OP_CXNN(){
     // get NN
     uint8_t NN = opcode & 0x00FF;
     // get VX
     uint8_t X  = (opcode & 0x0F00) >> 8;
-    // generate random number from 0 to 255
-    random_num = rand() % 255;
+    // generate random number from 0 to 255 with xorshift32, part of the
+    // state so a restored machine draws the same numbers
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    random_num = rng >> 24;
     // assign VX
     registers[X] = random_num & NN;
 }
@@ -466,15 +584,18 @@ void Chip8::OP_DXYN(){
 	uint8_t yPos = registers[Vy] % VIDEO_HEIGHT;
 
 	registers[0xF] = 0;
+	draw_flag = true;
 
-	for (unsigned int row = 0; row < height; ++row)
+	// the start position wraps, the sprite itself is clipped at the edges
+	for (unsigned int row = 0; row < height && yPos + row < VIDEO_HEIGHT; ++row)
 	{
-		uint8_t spriteByte = memory[I + row];
+		uint8_t spriteByte = memory[(I + row) & 0xFFF];
 
-		for (unsigned int col = 0; col < 8; ++col)
+		for (unsigned int col = 0; col < 8 && xPos + col < VIDEO_WIDTH; ++col)
 		{
 			uint8_t spritePixel = spriteByte & (0x80u >> col);
-			uint32_t* screenPixel = &screen[(yPos + row) * VIDEO_WIDTH + (xPos + col)];
+			int pixel = (yPos + row) * VIDEO_WIDTH + (xPos + col);
+			uint32_t* screenPixel = &screen[pixel];
 
 			// Sprite pixel is on
 			if (spritePixel)
@@ -487,6 +608,7 @@ void Chip8::OP_DXYN(){
 
 				// Effectively XOR with the sprite pixel
 				*screenPixel ^= 0xFFFFFFFF;
+				screen_zobrist ^= pixel_key(pixel);
 			}
 		}
 	}
@@ -496,8 +618,9 @@ void Chip8::OP_DXYN(){
 void Chip8::OP_EX9E(){
     // get X
     uint8_t X = (opcode & 0x0F00) >> 8;
+    key_reads++;
     // check if key stored in VX is pressed
-    if(key[registers[X]]){
+    if(key[registers[X] & 0xF]){
         pc += 2;
     }
 }
@@ -506,8 +629,9 @@ void Chip8::OP_EX9E(){
 void Chip8::OP_EXA1(){
     // get X
     uint8_t X = (opcode & 0x0F00) >> 8;
+    key_reads++;
     // check if key stored in VX is not pressed
-    if(!key[registers[X]]){
+    if(!key[registers[X] & 0xF]){
         pc += 2;
     }
 }
@@ -525,21 +649,16 @@ void Chip8::OP_FX0A(){
     // get X
     uint8_t X = (opcode & 0x0F00) >> 8;
 
-    // set bool to track key presses
-    bool key_is_pressed = false;
-
-    // loop until a key is pressed
-    while(!key_is_pressed){
-        // iterate through each key to see if it is pressed
-        for(int i = 0; i < 16; i++){
-            if(key[i]){
-                // store key and exit loop
-                key_is_pressed = true;
-                registers[X] = key[i];
-                break;
-            }
+    // store the first pressed key; with none, run this instruction again
+    // next cycle so the frontend keeps polling input meanwhile
+    key_reads++;
+    for(int i = 0; i < 16; i++){
+        if(key[i]){
+            registers[X] = i;
+            return;
         }
     }
+    pc -= 2;
 }
 
 // set delay timer to VX
@@ -578,17 +697,25 @@ void Chip8::OP_FX29(){
 // *(I+0) = BCD(3); *(I+1) = BCD(2); *(I+2) = BCD(1);
 void Chip8::OP_FX33(){
     // get X
-    uint8_t X = (opcode & 0x0F00) >> 8; 
+    uint8_t X = (opcode & 0x0F00) >> 8;
     uint8_t val = registers[X];
-
-    // store ones place in VX
-    memory[I + 2] = val % 10;
-    val = val/10;
-    // store tens place in VX
-    memory[I + 1] = val % 10;
-    val = val/10;
-    // store hundreds place in VX
-    memory[I] = val % 10;
+    uint8_t hundreds = val / 100, tens = val / 10 % 10, ones = val % 10;
+
+    uint16_t start = I & 0xFFF;
+    if(start < 4094){
+        // hundreds, tens and ones at I, hashed as one change
+        memory_sum += memory_delta(start, memory[start], hundreds)
+                    + memory_delta(start + 1, memory[start + 1], tens)
+                    + memory_delta(start + 2, memory[start + 2], ones);
+        memory[start] = hundreds;
+        memory[start + 1] = tens;
+        memory[start + 2] = ones;
+    }
+    else{
+        store(start, hundreds);
+        store((start + 1) & 0xFFF, tens);
+        store((start + 2) & 0xFFF, ones);
+    }
 }
 
 // stores V0 to VX in memory at index I offsets incremented by 1
@@ -597,9 +724,31 @@ void Chip8::OP_FX55(){
     uint8_t X = (opcode & 0x0F00) >> 8;
 
     // add V0 to VX to memory offset by 1
-    for(uint8_t i = 0; i <= X; i++){
-        memory[I + i] = registers[i];
+    // hash the whole block before storing it, the byte stores could alias memory_sum
+    uint64_t delta = 0;
+    uint16_t start = I & 0xFFF;
+    if(start + X < 4096){
+        // no wrap: contiguous keys, in two sums so the multiplies overlap
+        uint64_t odd = 0;
+        int i = 0;
+        for(; i + 1 <= X; i += 2){
+            delta += memory_delta(start + i, memory[start + i], registers[i]);
+            odd += memory_delta(start + i + 1, memory[start + i + 1], registers[i + 1]);
+        }
+        if(i <= X){
+            delta += memory_delta(start + i, memory[start + i], registers[i]);
+        }
+        delta += odd;
+        std::memcpy(&memory[start], registers, X + 1);
+    }
+    else{
+        for(int i = 0; i <= X; i++){
+            uint16_t address = (start + i) & 0xFFF;
+            delta += memory_delta(address, memory[address], registers[i]);
+            memory[address] = registers[i];
+        }
     }
+    memory_sum += delta;
 }
 
 // fulls V0 to VX from memory at index I with offsets incremented by 1
@@ -609,6 +758,6 @@ void Chip8::OP_FX65(){
 
     // fill V0 to VX from memory offset by 1
     for(uint8_t i = 0; i <= X; i++){
-        registers[i] = memory[I + i];
+        registers[i] = memory[(I + i) & 0xFFF];
     }
 }
\ No newline at end of file
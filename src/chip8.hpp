@@ -4,16 +4,81 @@
 #include <cstdlib>
 #include <iostream>
 
+#include "opcode_profile.hpp"
+#include "state_hash.hpp"
+
 #define VIDEO_HEIGHT 32
 #define VIDEO_WIDTH  64
 
+// everything an instruction can change, for checking one run against another
+struct Chip8State {
+    uint8_t  memory[4096];
+    uint8_t  registers[16];
+    uint16_t I;
+    uint16_t pc;
+    uint16_t stack[16];
+    uint8_t  sp;
+    uint8_t  delay_timer;
+    uint8_t  sound_timer;
+    uint32_t rng;
+    uint32_t screen[VIDEO_WIDTH * VIDEO_HEIGHT];
+};
+
 class Chip8 {
     public:
         Chip8();
         void loadROM(const char*);      // load ROM data into memory
-        void cycle();                   // execution cycle
+        void load(const uint8_t *rom, size_t size);     // load ROM bytes, cut at the end of memory
+        void cycle() { NoProfile none; step(none); }    // execution cycle
+        template<typename Profiler>
+        void step(Profiler &profiler);  // cycle() reporting each instruction to a policy
+        void expand_screen(uint8_t*) const; // write screen as one byte per pixel (0 or 255)
+        Chip8State state() const;       // copy of the machine state
+        void restore(const Chip8State&);    // put a copy back, as if it had run to there
+        // the same with its memory_hash() and screen_hash() from when it was
+        // taken, which skips working them out again (built with
+        // CHIP8_CHECK_HASHES it works them out anyway and asserts they match)
+        void restore(const Chip8State&, uint64_t memory_known, uint64_t screen_known);
+        void seed(uint32_t value) { rng = value ? value : 1; }  // make CXNN repeatable
+        // kept up to date on every store and drawn pixel, see state_hash.hpp
+        uint64_t memory_hash() const { return memory_sum; }
+        uint64_t screen_hash() const { return screen_zobrist; }
+        uint64_t state_hash() const {
+            return cpu_hash(memory_sum ^ screen_zobrist, registers, stack, I, pc, sp, delay_timer, sound_timer, rng);
+        }
+        // read access for reward functions and other tools
+        uint8_t  peek(uint16_t address) const { return memory[address & 0xFFF]; }
+        uint8_t  reg(int x) const { return registers[x & 0xF]; }
+        uint16_t program_counter() const { return pc; }
+        // on a jump to itself, the way a ROM stops for good
+        bool halted() const {
+            return (memory[pc & 0xFFF] >> 4) == 0x1 && ((memory[pc & 0xFFF] & 0x0F) << 8 | memory[(pc + 1) & 0xFFF]) == (pc & 0xFFF);
+        }
         uint8_t  key[16]{};             // stores current state of keyboard keys 0-F.
         uint32_t screen[VIDEO_WIDTH * VIDEO_HEIGHT]{};   // stores on/off for pixels on screen
+        bool     draw_flag{};           // set when screen changes, cleared by the frontend
+        unsigned long invalid_opcodes{};    // decoded to no instruction, counted off the hot path
+        unsigned long key_reads{};          // EX9E, EXA1 and FX0A run, for input latency
+
+        // built-in 4x5 hex digits, one byte per row in the high nibble
+        static constexpr uint8_t fontset[80] = {
+            0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+            0x20, 0x60, 0x20, 0x20, 0x70, // 1
+            0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+            0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+            0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+            0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+            0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+            0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+            0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+            0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+            0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+            0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+            0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+            0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+            0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+            0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+        };
 
     private:
         // opcodes
@@ -38,7 +103,7 @@ class Chip8 {
         void OP_9XY0();     // skip if VX != VY
         void OP_ANNN();     // set I to NNN
         void OP_BNNN();     // JMP to NNN + V0
-        void OP_CXNN();     // set VX = rand() & NN
+        void OP_CXNN();     // set VX = random & NN
         void OP_DXYN();     // draw sprite
         void OP_EX9E();     // if (key() == Vx), skip next direction
         void OP_EXA1();     // if (key() != Vx), skip next direction
@@ -52,6 +117,13 @@ class Chip8 {
         void OP_FX55();     // reg_dump(Vx, &I)
         void OP_FX65();     // reg_load(Vx, &I)
 
+        void store(uint16_t address, uint8_t value){
+            memory_sum += memory_delta(address, memory[address], value);
+            memory[address] = value;
+        }
+        void rehash();      // after memory or screen were replaced wholesale
+        void copy_in(const Chip8State&);    // restore() without the hashes
+
         // components of Chip-8 emulator
         uint16_t  opcode{};           // CPU instruction to be executed
         uint8_t   memory[4096]{};     // 4KB addressed 0x000 to 0xFFF
@@ -66,25 +138,9 @@ class Chip8 {
         uint8_t   delay_timer{};      // used for timing
         uint8_t   sound_timer{};      // beeps when reaches 0
         uint8_t   random_num{};       // used for certain opcodes
-        
+        uint32_t  rng{1};             // xorshift state behind random_num, never 0
+        uint64_t  memory_sum{};       // hashes of memory and screen, see state_hash.hpp
+        uint64_t  screen_zobrist{};
 
-        uint8_t fontset[80] = {
-            0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-            0x20, 0x60, 0x20, 0x20, 0x70, // 1
-            0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-            0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-            0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-            0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-            0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-            0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-            0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-            0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-            0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-            0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-            0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-            0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-            0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-            0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-        };    
 };
 #endif
\ No newline at end of file
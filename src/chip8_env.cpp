@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "chip8.hpp"
+#include "chip8_env.h"
+
+#define ENV_CHUNK 4                     // instances a thread takes at a time
+
+// one environment copy
+struct Instance {
+    Chip8 *chip8;
+    uint32_t seed;
+    uint32_t episodes;
+    bool restart;                       // reported done, starts over next step
+};
+
+struct Chip8Env {
+    Chip8State boot;
+    uint64_t boot_memory, boot_screen;
+    std::vector<Instance> instances;
+    Chip8EnvReward reward{};
+    void *user{};
+    int cycles_per_frame{CHIP8_ENV_CYCLES_PER_FRAME};
+    std::atomic<uint64_t> steps{}, instructions{};
+
+    // the step being run, read by every thread
+    const uint16_t *actions{};
+    int frames{};
+    uint8_t *observations{};
+    float *rewards{};
+    uint8_t *dones{};
+    std::atomic<int> next{};
+
+    // pool: workers wait for generation to move, run their share, and the
+    // last one out wakes the caller
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable start, finished;
+    uint64_t generation{};
+    int busy{};
+    bool quit{};
+};
+
+static void start_episode(Chip8Env *env, Instance &instance){
+    instance.chip8->restore(env->boot, env->boot_memory, env->boot_screen);
+    // later episodes mix in their number so instances do not replay each other
+    uint32_t seed = instance.episodes ? (uint32_t)mix64((uint64_t)instance.seed << 32 | instance.episodes) : instance.seed;
+    instance.chip8->seed(seed);
+    for(int key = 0; key < 16; key++){
+        instance.chip8->key[key] = 0;
+    }
+    instance.restart = false;
+}
+
+static void step_instance(Chip8Env *env, int i){
+    Instance &instance = env->instances[i];
+    Chip8 *chip8 = instance.chip8;
+    if(instance.restart){
+        instance.episodes++;
+        start_episode(env, instance);
+    }
+    uint16_t action = env->actions ? env->actions[i] : 0;
+    for(int key = 0; key < 16; key++){
+        chip8->key[key] = (action >> key) & 1;
+    }
+    int cycles = env->frames * env->cycles_per_frame;
+    for(int c = 0; c < cycles; c++){
+        chip8->cycle();
+    }
+
+    float reward = 0;
+    uint8_t done = 0;
+    if(env->reward){
+        env->reward(env->user, env, i, &reward, &done);
+    }
+    instance.restart = done != 0;
+    if(env->observations){
+        chip8->expand_screen(env->observations + (size_t)i * CHIP8_ENV_OBSERVATION);
+    }
+    if(env->rewards){
+        env->rewards[i] = reward;
+    }
+    if(env->dones){
+        env->dones[i] = done;
+    }
+}
+
+// takes chunks of instances until the step has none left
+static void run_share(Chip8Env *env){
+    int n = (int)env->instances.size();
+    for(;;){
+        int begin = env->next.fetch_add(ENV_CHUNK);
+        if(begin >= n){
+            return;
+        }
+        int end = std::min(begin + ENV_CHUNK, n);
+        for(int i = begin; i < end; i++){
+            step_instance(env, i);
+        }
+    }
+}
+
+static void worker(Chip8Env *env){
+    uint64_t seen = 0;
+    for(;;){
+        {
+            std::unique_lock<std::mutex> guard(env->lock);
+            env->start.wait(guard, [&]{ return env->quit || env->generation != seen; });
+            if(env->quit){
+                return;
+            }
+            seen = env->generation;
+        }
+        run_share(env);
+        std::lock_guard<std::mutex> guard(env->lock);
+        if(--env->busy == 0){
+            env->finished.notify_one();
+        }
+    }
+}
+
+Chip8Env *chip8_env_create(const uint8_t *rom, size_t size, int threads){
+    if(size > 4096 - 0x200){
+        return nullptr;
+    }
+    Chip8Env *env = new Chip8Env();
+    Chip8 *boot = new Chip8();
+    boot->load(rom, size);
+    env->boot = boot->state();
+    env->boot_memory = boot->memory_hash();
+    env->boot_screen = boot->screen_hash();
+    delete boot;
+
+    // the calling thread runs a share too
+    if(threads <= 0){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(int t = 1; t < threads; t++){
+        env->workers.emplace_back(worker, env);
+    }
+    return env;
+}
+
+void chip8_env_destroy(Chip8Env *env){
+    if(!env){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(env->lock);
+        env->quit = true;
+    }
+    env->start.notify_all();
+    for(std::thread &thread : env->workers){
+        thread.join();
+    }
+    for(Instance &instance : env->instances){
+        delete instance.chip8;
+    }
+    delete env;
+}
+
+void chip8_env_set_reward(Chip8Env *env, Chip8EnvReward reward, void *user){
+    env->reward = reward;
+    env->user = user;
+}
+
+void chip8_env_set_cycles_per_frame(Chip8Env *env, int cycles){
+    env->cycles_per_frame = std::max(1, cycles);
+}
+
+void chip8_env_reset(Chip8Env *env, int n, const uint32_t *seeds, uint8_t *observations){
+    n = std::max(0, n);
+    while((int)env->instances.size() > n){
+        delete env->instances.back().chip8;
+        env->instances.pop_back();
+    }
+    while((int)env->instances.size() < n){
+        env->instances.push_back(Instance{new Chip8(), 0, 0, false});
+    }
+    for(int i = 0; i < n; i++){
+        Instance &instance = env->instances[i];
+        instance.seed = seeds ? seeds[i] : (uint32_t)i + 1;
+        instance.episodes = 0;
+        start_episode(env, instance);
+        if(observations){
+            instance.chip8->expand_screen(observations + (size_t)i * CHIP8_ENV_OBSERVATION);
+        }
+    }
+}
+
+void chip8_env_step(Chip8Env *env, const uint16_t *actions, int frames,
+                    uint8_t *observations, float *rewards, uint8_t *dones){
+    env->actions = actions;
+    env->frames = std::max(0, frames);
+    env->observations = observations;
+    env->rewards = rewards;
+    env->dones = dones;
+    env->next.store(0);
+
+    // too few instances to share are not worth waking the pool for
+    int n = (int)env->instances.size();
+    if(env->workers.empty() || n <= ENV_CHUNK){
+        run_share(env);
+    }
+    else{
+        {
+            std::lock_guard<std::mutex> guard(env->lock);
+            env->busy = (int)env->workers.size();
+            env->generation++;
+        }
+        env->start.notify_all();
+        run_share(env);
+        std::unique_lock<std::mutex> guard(env->lock);
+        env->finished.wait(guard, [&]{ return env->busy == 0; });
+    }
+    env->steps += n;
+    env->instructions += (uint64_t)n * env->frames * env->cycles_per_frame;
+}
+
+int chip8_env_count(const Chip8Env *env){
+    return (int)env->instances.size();
+}
+
+uint8_t chip8_env_peek(const Chip8Env *env, int instance, uint16_t address){
+    return env->instances[instance].chip8->peek(address);
+}
+
+uint8_t chip8_env_register(const Chip8Env *env, int instance, int x){
+    return env->instances[instance].chip8->reg(x);
+}
+
+uint64_t chip8_env_steps(const Chip8Env *env){
+    return env->steps.load();
+}
+
+uint64_t chip8_env_instructions(const Chip8Env *env){
+    return env->instructions.load();
+}
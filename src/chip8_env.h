@@ -0,0 +1,68 @@
+#ifndef CHIP8_ENV_H
+#define CHIP8_ENV_H
+#include <stddef.h>
+#include <stdint.h>
+
+/* C interface for running many copies of one ROM in lockstep, for training
+ * agents. Every instance gets an action (a mask of held keys, bit n for key n)
+ * and runs a number of frames; the instances are split across a pool of
+ * threads. Screens go straight into one caller-owned buffer of
+ * n * CHIP8_ENV_OBSERVATION bytes, instance after instance, one byte per
+ * pixel (0 or 255) in rows of 64. Rewards and episode ends come from a
+ * callback that reads the machine through chip8_env_peek() and
+ * chip8_env_register(). An instance that reported done starts over from the
+ * ROM's first state at its next step, seeded from its reset seed and the
+ * number of episodes it has finished. */
+
+/* the library is built with hidden visibility, only these functions are exported */
+#if defined(__GNUC__)
+#define CHIP8_ENV_API __attribute__((visibility("default")))
+#else
+#define CHIP8_ENV_API
+#endif
+
+#define CHIP8_ENV_OBSERVATION (64 * 32)
+#define CHIP8_ENV_CYCLES_PER_FRAME 10   /* as chip8-headless runs by default */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Chip8Env Chip8Env;
+
+/* called for every instance after each step, on the pool's threads, so it
+ * must be safe to call concurrently for different instances. reward and done
+ * start at 0. */
+typedef void (*Chip8EnvReward)(void *user, const Chip8Env *env, int instance, float *reward, uint8_t *done);
+
+/* a copy of the ROM is kept; threads 0 uses one per core. NULL if the ROM
+ * does not fit in memory. */
+CHIP8_ENV_API Chip8Env *chip8_env_create(const uint8_t *rom, size_t size, int threads);
+CHIP8_ENV_API void chip8_env_destroy(Chip8Env *env);
+
+CHIP8_ENV_API void chip8_env_set_reward(Chip8Env *env, Chip8EnvReward reward, void *user);
+CHIP8_ENV_API void chip8_env_set_cycles_per_frame(Chip8Env *env, int cycles);
+
+/* starts n instances from the ROM's first state, seeding instance i's CXNN
+ * random numbers with seeds[i] (i + 1 when seeds is NULL), and writes their
+ * screens to observations unless it is NULL */
+CHIP8_ENV_API void chip8_env_reset(Chip8Env *env, int n, const uint32_t *seeds, uint8_t *observations);
+
+/* holds actions[i] on instance i for frames frames. Any of observations,
+ * rewards (n floats) and dones (n bytes) may be NULL. */
+CHIP8_ENV_API void chip8_env_step(Chip8Env *env, const uint16_t *actions, int frames,
+                    uint8_t *observations, float *rewards, uint8_t *dones);
+
+CHIP8_ENV_API int chip8_env_count(const Chip8Env *env);
+CHIP8_ENV_API uint8_t chip8_env_peek(const Chip8Env *env, int instance, uint16_t address);
+CHIP8_ENV_API uint8_t chip8_env_register(const Chip8Env *env, int instance, int x);
+
+/* instance steps and instructions run since creation */
+CHIP8_ENV_API uint64_t chip8_env_steps(const Chip8Env *env);
+CHIP8_ENV_API uint64_t chip8_env_instructions(const Chip8Env *env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+#include <cstring>
+#include <iomanip>
+
+#include "chip8_state.hpp"
+
+uint64_t memory_hash(const Chip8State &state){
+    uint64_t hash = 0;
+    for(int i = 0; i < 4096; i++){
+        hash += memory_delta(i, 0, state.memory[i]);
+    }
+    return hash;
+}
+
+uint64_t screen_hash(const Chip8State &state){
+    uint64_t hash = 0;
+    for(int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++){
+        if(state.screen[i]){
+            hash ^= pixel_key(i);
+        }
+    }
+    return hash;
+}
+
+uint64_t state_hash(const Chip8State &state){
+    return cpu_hash(memory_hash(state) ^ screen_hash(state), state.registers, state.stack, state.I, state.pc,
+                    state.sp, state.delay_timer, state.sound_timer, state.rng);
+}
+
+bool same_state(const Chip8State &a, const Chip8State &b){
+    // field by field, padding between them is undefined
+    return a.I == b.I && a.pc == b.pc && a.sp == b.sp &&
+           a.delay_timer == b.delay_timer && a.sound_timer == b.sound_timer && a.rng == b.rng &&
+           std::memcmp(a.registers, b.registers, sizeof(a.registers)) == 0 &&
+           std::memcmp(a.stack, b.stack, sizeof(a.stack)) == 0 &&
+           std::memcmp(a.memory, b.memory, sizeof(a.memory)) == 0 &&
+           screen_hash(a) == screen_hash(b);
+}
+
+void print_differences(std::ostream &out, const Chip8State &a, const Chip8State &b,
+                       const char *a_name, const char *b_name){
+    std::ios::fmtflags flags = out.flags();
+    out << std::hex;
+    auto field = [&](const char *name, int index, unsigned long first, unsigned long second){
+        if(first == second){
+            return;
+        }
+        out << "  " << name;
+        if(index >= 0){
+            out << "[" << index << "]";
+        }
+        out << ": " << a_name << " " << first << ", " << b_name << " " << second << "\n";
+    };
+    field("pc", -1, a.pc, b.pc);
+    field("I", -1, a.I, b.I);
+    field("sp", -1, a.sp, b.sp);
+    field("delay_timer", -1, a.delay_timer, b.delay_timer);
+    field("sound_timer", -1, a.sound_timer, b.sound_timer);
+    field("rng", -1, a.rng, b.rng);
+    for(int i = 0; i < 16; i++){
+        field("V", i, a.registers[i], b.registers[i]);
+    }
+    for(int i = 0; i < 16; i++){
+        field("stack", i, a.stack[i], b.stack[i]);
+    }
+    for(int i = 0; i < 4096; i++){
+        field("memory", i, a.memory[i], b.memory[i]);
+    }
+    int pixels = 0;
+    for(int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++){
+        pixels += (a.screen[i] != 0) != (b.screen[i] != 0);
+    }
+    out << std::dec;
+    if(pixels){
+        out << "  screen: " << pixels << " pixels differ\n";
+    }
+    out.flags(flags);
+}
+
+void print_state(std::ostream &out, const Chip8State &state){
+    std::ios::fmtflags flags = out.flags();
+    out << std::hex << std::setfill('0')
+        << "  pc " << std::setw(3) << state.pc << "  opcode " << std::setw(2) << (int)state.memory[state.pc & 0xFFF]
+        << std::setw(2) << (int)state.memory[(state.pc + 1) & 0xFFF] << "  I " << std::setw(3) << state.I
+        << "  sp " << (int)state.sp << "  delay " << std::setw(2) << (int)state.delay_timer
+        << "  sound " << std::setw(2) << (int)state.sound_timer << "\n  V ";
+    for(int i = 0; i < 16; i++){
+        out << std::setw(2) << (int)state.registers[i] << (i < 15 ? " " : "\n  stack ");
+    }
+    for(int i = 0; i < 16; i++){
+        out << std::setw(3) << state.stack[i] << (i < 15 ? " " : "\n");
+    }
+    out << "  memory " << std::setw(16) << memory_hash(state)
+        << "  screen " << std::setw(16) << screen_hash(state) << "\n";
+    out.flags(flags);
+}
@@ -0,0 +1,24 @@
+#ifndef CHIP8_STATE_HPP
+#define CHIP8_STATE_HPP
+#include <cstdint>
+#include <iostream>
+
+#include "chip8.hpp"
+
+// comparing and printing Chip8State snapshots, for the ROM generator's
+// checks and the lockstep checker
+
+// from scratch, equal to the hashes Chip8 keeps for the same state
+uint64_t memory_hash(const Chip8State &state);
+uint64_t screen_hash(const Chip8State &state);
+uint64_t state_hash(const Chip8State &state);
+bool same_state(const Chip8State &a, const Chip8State &b);
+
+// one line per field that differs, labelled with the two names
+void print_differences(std::ostream &out, const Chip8State &a, const Chip8State &b,
+                       const char *a_name, const char *b_name);
+
+// registers, pointers, stack, timers and hashes on a few lines
+void print_state(std::ostream &out, const Chip8State &state);
+
+#endif
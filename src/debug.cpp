@@ -0,0 +1,259 @@
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chip8.hpp"
+#include "chip8_state.hpp"
+#include "movie.hpp"
+#include "timeline.hpp"
+
+// a debugger that steps backwards as well as forwards. The run is kept as a
+// Timeline: checkpoints every few thousand instructions and a log of key
+// changes, so stepping back restores a checkpoint and re-executes up to the
+// instruction before. Commands come from stdin, one per line:
+//   chip8-debug <rom> [options] < commands
+#define DEBUG_RUN_LIMIT 100000000ul     // continue gives up after this many instructions
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --seed <n>              CXNN random seed (default 1)\n"
+              << "  --replay <movie>        take the seed and key changes from an input movie\n"
+              << "  --break <addr>          breakpoint on an instruction address, may repeat\n"
+              << "  --history-mb <n>        memory for checkpoints (default " << (TIMELINE_MAX_BYTES >> 20) << ")\n"
+              << "  --max-replay-ms <ms>    longest re-execution for one step back (default " << TIMELINE_MAX_REPLAY_MS << ")\n"
+              << "  --interval <n>          instructions between checkpoints to start with (default " << TIMELINE_INTERVAL << ")\n";
+    std::exit(EXIT_FAILURE);
+}
+
+static void help()
+{
+    std::cout << "  s [n]          step n instructions (default 1)\n"
+              << "  rs [n]         step n instructions back\n"
+              << "  c              continue to the next breakpoint\n"
+              << "  rc             continue backwards to the previous breakpoint\n"
+              << "  goto <n>       move to instruction n\n"
+              << "  b [addr]       set a breakpoint, or list them\n"
+              << "  d <addr>       delete a breakpoint\n"
+              << "  keys <list>    hold keys from here on: none, or hex digits like 4+6\n"
+              << "  regs           registers, stack and timers\n"
+              << "  x <addr> [n]   n bytes of memory (default 16)\n"
+              << "  info           checkpoints, history and re-execution cost\n"
+              << "  q              quit; an empty line repeats the last command\n";
+}
+
+static bool parse_number(const std::string &text, unsigned long &value)
+{
+    if (text.empty())
+        return false;
+    char *end;
+    value = std::strtoul(text.c_str(), &end, 0);
+    return !*end;
+}
+
+// none, or hex digits joined by + or ,
+static bool parse_keys(const std::string &text, uint16_t &mask)
+{
+    mask = 0;
+    if (text == "none")
+        return true;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (std::isxdigit((unsigned char)text[i]) && (i + 1 == text.size() || text[i + 1] == '+' || text[i + 1] == ','))
+            mask |= 1 << std::stoi(text.substr(i, 1), nullptr, 16);
+        else if (text[i] != '+' && text[i] != ',')
+            return false;
+        else if (i == 0 || i + 1 == text.size())
+            return false;
+    }
+    return !text.empty();
+}
+
+// where the run is: instruction count, the next instruction and the keys held
+static void show(const Chip8 &chip8, const Timeline &timeline)
+{
+    uint16_t pc = chip8.program_counter();
+    std::ios::fmtflags flags = std::cout.flags();
+    std::cout << "instruction " << timeline.now() << std::hex << std::setfill('0') << "  pc " << std::setw(3) << pc
+              << "  opcode " << std::setw(2) << (int)chip8.peek(pc) << std::setw(2) << (int)chip8.peek(pc + 1)
+              << "  keys " << std::setw(4) << timeline.keys() << "\n";
+    std::cout.flags(flags);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+        usage(argv[0]);
+    uint32_t seed = 1;
+    const char *replay = nullptr;
+    size_t historyBytes = TIMELINE_MAX_BYTES;
+    double maxReplayMs = TIMELINE_MAX_REPLAY_MS;
+    unsigned long interval = TIMELINE_INTERVAL;
+    std::vector<uint16_t> breaks;
+    for (int i = 2; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+            seed = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        else if (std::strcmp(argv[i], "--replay") == 0 && hasValue)
+            replay = argv[++i];
+        else if (std::strcmp(argv[i], "--break") == 0 && hasValue)
+            breaks.push_back((uint16_t)std::strtoul(argv[++i], nullptr, 0));
+        else if (std::strcmp(argv[i], "--history-mb") == 0 && hasValue)
+            historyBytes = std::strtoul(argv[++i], nullptr, 0) << 20;
+        else if (std::strcmp(argv[i], "--max-replay-ms") == 0 && hasValue)
+            maxReplayMs = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--interval") == 0 && hasValue)
+            interval = std::strtoul(argv[++i], nullptr, 0);
+        else
+            usage(argv[0]);
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot read " << argv[1] << "\n";
+        return EXIT_FAILURE;
+    }
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Movie movie;
+    if (replay)
+    {
+        if (!load_movie(replay, movie))
+            return EXIT_FAILURE;
+        if (movie.rom_hash != rom_hash(rom.data(), rom.size()))
+        {
+            std::cerr << replay << " was recorded with a different ROM than " << argv[1] << "\n";
+            return EXIT_FAILURE;
+        }
+        seed = movie.seed;
+    }
+
+    Chip8 *chip8 = new Chip8();
+    chip8->load(rom.data(), rom.size());
+    chip8->seed(seed);
+    Timeline timeline(*chip8, historyBytes, maxReplayMs, interval);
+    if (replay)
+        timeline.load_inputs(movie);
+    for (uint16_t address : breaks)
+        timeline.breakpoint(address, true);
+
+    bool prompt = isatty(STDIN_FILENO);
+    std::string line, last;
+    show(*chip8, timeline);
+    for (;;)
+    {
+        if (prompt)
+            std::cout << "(chip8) " << std::flush;
+        if (!std::getline(std::cin, line))
+            break;
+        if (line.find_first_not_of(" \t") == std::string::npos)
+            line = last;
+        last = line;
+        std::istringstream words(line);
+        std::string command, first, second;
+        words >> command >> first >> second;
+        unsigned long n = 1;
+        if (!first.empty() && (command == "s" || command == "rs" || command == "goto" || command == "b"
+                               || command == "d" || command == "x") && !parse_number(first, n))
+        {
+            std::cout << "not a number: " << first << "\n";
+            continue;
+        }
+
+        if (command.empty())
+            continue;
+        else if (command == "q")
+            break;
+        else if (command == "s")
+        {
+            timeline.seek(timeline.now() + n);
+            show(*chip8, timeline);
+        }
+        else if (command == "rs")
+        {
+            bool before = n > timeline.now();
+            if (!timeline.seek(timeline.now() - std::min<uint64_t>(n, timeline.now())) || before)
+                std::cout << "history starts at instruction " << timeline.oldest() << "\n";
+            show(*chip8, timeline);
+        }
+        else if (command == "goto" && !first.empty())
+        {
+            if (!timeline.seek(n))
+                std::cout << "history starts at instruction " << timeline.oldest() << "\n";
+            show(*chip8, timeline);
+        }
+        else if (command == "c")
+        {
+            if (!timeline.resume(DEBUG_RUN_LIMIT))
+                std::cout << "no breakpoint in " << DEBUG_RUN_LIMIT << " instructions\n";
+            show(*chip8, timeline);
+        }
+        else if (command == "rc")
+        {
+            if (!timeline.reverse_resume())
+                std::cout << "no breakpoint since instruction " << timeline.oldest() << "\n";
+            show(*chip8, timeline);
+        }
+        else if (command == "b" && !first.empty())
+            timeline.breakpoint((uint16_t)n, true);
+        else if (command == "b")
+        {
+            std::cout << "breakpoints:" << std::hex;
+            for (int address = 0; address < 4096; address++)
+                if (timeline.breakpoint(address))
+                    std::cout << " " << address;
+            std::cout << std::dec << "\n";
+        }
+        else if (command == "d" && !first.empty())
+            timeline.breakpoint((uint16_t)n, false);
+        else if (command == "keys" && !first.empty())
+        {
+            uint16_t mask;
+            if (!parse_keys(first, mask))
+                std::cout << "not a key list: " << first << "\n";
+            else
+            {
+                uint64_t frontier = timeline.frontier();
+                timeline.set_keys(mask);
+                if (timeline.frontier() < frontier)
+                    std::cout << "history after instruction " << timeline.now() << " dropped\n";
+            }
+        }
+        else if (command == "regs")
+            print_state(std::cout, chip8->state());
+        else if (command == "x" && !first.empty())
+        {
+            unsigned long count = 16;
+            if (!second.empty() && !parse_number(second, count))
+                count = 16;
+            std::ios::fmtflags flags = std::cout.flags();
+            std::cout << std::hex << std::setfill('0');
+            for (unsigned long i = 0; i < count; i++)
+            {
+                if (i % 16 == 0)
+                    std::cout << (i ? "\n" : "") << std::setw(3) << ((n + i) & 0xFFF) << ":";
+                std::cout << " " << std::setw(2) << (int)chip8->peek((uint16_t)(n + i));
+            }
+            std::cout << "\n";
+            std::cout.flags(flags);
+        }
+        else if (command == "info")
+            timeline.report(std::cout);
+        else
+            help();
+    }
+
+    delete chip8;
+    return 0;
+}
@@ -0,0 +1,24 @@
+#!/bin/sh
+# embeds every shader and preset under a directory as constexpr strings so
+# the emulator starts without reading shaders/ from the working directory
+# usage: sh embed_shaders.sh shaders > embedded_shaders.hpp
+dir=${1:-shaders}
+
+echo "// generated by embed_shaders.sh from $dir/, do not edit"
+echo "#ifndef EMBEDDED_SHADERS_HPP"
+echo "#define EMBEDDED_SHADERS_HPP"
+echo ""
+echo "struct EmbeddedFile {"
+echo "    const char *name;     // path relative to $dir/"
+echo "    const char *text;"
+echo "};"
+echo ""
+echo "static constexpr EmbeddedFile embedded_files[] = {"
+for name in $(cd "$dir" && find . -type f \( -name '*.vert' -o -name '*.frag' -o -name '*.preset' \) | sed 's|^\./||' | sort); do
+    printf '    { "%s", R"embed(' "$name"
+    cat "$dir/$name"
+    printf ')embed" },\n'
+done
+echo "};"
+echo ""
+echo "#endif"
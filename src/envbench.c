@@ -0,0 +1,144 @@
+#define _POSIX_C_SOURCE 199309L    /* clock_gettime */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chip8_env.h"
+
+/* drives libchip8env through its C interface the way a training loop would:
+ * random actions for every instance each step, a reward callback, episodes
+ * that end after a fixed number of steps, and reports environment steps per
+ * second:
+ *   chip8-envbench <rom> [--envs n] [--frames n] [--steps n] [--threads n] [--episode n] */
+#define ENVBENCH_ENVS 64
+#define ENVBENCH_FRAMES 4
+#define ENVBENCH_STEPS 2000
+#define ENVBENCH_EPISODE 500
+
+/* per-instance step counts; the callback only touches its own instance */
+struct Episodes
+{
+    int length;
+    int *steps;
+};
+
+/* a stand-in reward: VF, which DXYN sets on a collision */
+static void reward(void *user, const Chip8Env *env, int instance, float *value, uint8_t *done)
+{
+    struct Episodes *episodes = (struct Episodes*)user;
+    *value = (float)chip8_env_register(env, instance, 0xF);
+    if (++episodes->steps[instance] >= episodes->length)
+    {
+        episodes->steps[instance] = 0;
+        *done = 1;
+    }
+}
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s <rom> [options]\n"
+                    "  --envs <n>      instances stepped together (default %d)\n"
+                    "  --frames <n>    frames per step (default %d)\n"
+                    "  --steps <n>     steps to time (default %d)\n"
+                    "  --threads <n>   default: one per core\n"
+                    "  --episode <n>   steps before an instance reports done (default %d)\n",
+            program, ENVBENCH_ENVS, ENVBENCH_FRAMES, ENVBENCH_STEPS, ENVBENCH_EPISODE);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+    int envs = ENVBENCH_ENVS, frames = ENVBENCH_FRAMES, steps = ENVBENCH_STEPS, threads = 0;
+    struct Episodes episodes = { ENVBENCH_EPISODE, NULL };
+    if (argc < 2)
+        usage(argv[0]);
+    for (int i = 2; i < argc; i++)
+    {
+        int hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--envs") == 0 && hasValue)
+            envs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+            frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--steps") == 0 && hasValue)
+            steps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--episode") == 0 && hasValue)
+            episodes.length = atoi(argv[++i]);
+        else
+            usage(argv[0]);
+    }
+    if (envs < 1 || frames < 1 || steps < 1 || episodes.length < 1)
+        usage(argv[0]);
+
+    FILE *file = fopen(argv[1], "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    uint8_t rom[4096];
+    size_t size = fread(rom, 1, sizeof(rom), file);
+    fclose(file);
+    Chip8Env *env = chip8_env_create(rom, size, threads);
+    if (!env)
+    {
+        fprintf(stderr, "%s does not fit in memory\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    episodes.steps = calloc(envs, sizeof(int));
+    uint8_t *observations = malloc((size_t)envs * CHIP8_ENV_OBSERVATION);
+    uint16_t *actions = malloc(envs * sizeof(uint16_t));
+    float *rewards = malloc(envs * sizeof(float));
+    uint8_t *dones = malloc(envs);
+    chip8_env_set_reward(env, reward, &episodes);
+    chip8_env_reset(env, envs, NULL, observations);
+
+    uint32_t random = 1;
+    long finished = 0;
+    double score = 0;
+    double start = now();
+    for (int step = 0; step < steps; step++)
+    {
+        for (int i = 0; i < envs; i++)
+        {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            actions[i] = (random & 3) ? 0 : 1 << (random >> 28);
+        }
+        chip8_env_step(env, actions, frames, observations, rewards, dones);
+        for (int i = 0; i < envs; i++)
+        {
+            score += rewards[i];
+            finished += dones[i];
+        }
+    }
+    double seconds = now() - start;
+
+    long lit = 0;
+    for (size_t i = 0; i < (size_t)envs * CHIP8_ENV_OBSERVATION; i++)
+        lit += observations[i] != 0;
+    printf("%d envs x %d steps of %d frames in %.3f s: %.0f env steps/s, %.1f M instructions/s\n",
+           envs, steps, frames, seconds, chip8_env_steps(env) / seconds, chip8_env_instructions(env) / seconds / 1e6);
+    printf("%ld episodes finished, total reward %.0f, %ld pixels lit in the last observations\n",
+           finished, score, lit);
+
+    chip8_env_destroy(env);
+    free(episodes.steps);
+    free(observations);
+    free(actions);
+    free(rewards);
+    free(dones);
+    return 0;
+}
@@ -0,0 +1,451 @@
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chip8.hpp"
+#include "chip8_state.hpp"
+#include "state_set.hpp"
+
+// searches for key presses that take a ROM to a goal state. Every state
+// branches on each input choice, held for a few frames, and keeps only the
+// children no thread has reached before, by state hash in a shared set.
+// Levels are expanded breadth first with the frontier split across threads,
+// so the first goal found is reached by one of the shortest input sequences:
+//   chip8-explore <rom> --goal <predicate> [--goal ...] [options]
+// A predicate compares V0-VF, I, pc, sp, dt, st or mem[addr] with a number,
+// like V3==5, mem[0x3F0]>=2 or pc!=0x2A4; all of them have to hold.
+#define EXPLORE_FRAMES 6                // an input is held this long
+#define EXPLORE_CYCLES_PER_FRAME 10     // as chip8-headless runs by default
+#define EXPLORE_DEPTH 30
+#define EXPLORE_MAX_FRONTIER 4096       // states kept per level, each a full snapshot
+#define EXPLORE_MAX_STATES (1 << 20)
+#define EXPLORE_CHUNK 8                 // frontier states a thread takes at a time
+#define NO_PARENT 0xFFFFFFFFu
+
+enum GoalField { GOAL_REGISTER, GOAL_I, GOAL_PC, GOAL_SP, GOAL_DELAY, GOAL_SOUND, GOAL_MEMORY };
+enum GoalOp { GOAL_EQ, GOAL_NE, GOAL_LT, GOAL_LE, GOAL_GT, GOAL_GE };
+
+struct Goal {
+    GoalField field;
+    unsigned where;                     // register number or memory address
+    GoalOp op;
+    unsigned long value;
+};
+
+struct Search {
+    std::vector<Goal> goals;
+    std::vector<uint16_t> inputs;       // key masks to branch on, 0 holds none
+    int frames{EXPLORE_FRAMES};
+    int cyclesPerFrame{EXPLORE_CYCLES_PER_FRAME};
+    int depth{EXPLORE_DEPTH};
+    size_t maxFrontier{EXPLORE_MAX_FRONTIER};
+    size_t maxStates{EXPLORE_MAX_STATES};
+    unsigned threads{};
+};
+
+// a frontier state, with the hashes restore() can skip working out and the
+// input that led to it
+struct Node {
+    Chip8State state;
+    uint64_t memoryHash, screenHash;
+    uint32_t parent;                    // into the links of earlier levels
+    uint16_t input;
+};
+
+struct Link {
+    uint32_t parent;
+    uint16_t input;
+};
+
+// what the threads expanding one level share
+struct Level {
+    const std::vector<Node> *frontier;
+    std::atomic<size_t> next{};
+    std::atomic<size_t> kept{};
+    std::atomic<unsigned long> expanded{}, duplicates{}, pruned{};
+    std::atomic<bool> found{};
+    std::mutex lock;
+    Node goal;
+};
+
+static bool parse_goal(const char *text, Goal &goal)
+{
+    std::string s = text;
+    size_t at = s.find_first_of("=!<>");
+    if (at == std::string::npos || at == 0)
+        return false;
+    std::string field = s.substr(0, at);
+    static const char *const ops[] = { "==", "!=", "<=", ">=", "<", ">" };
+    static const GoalOp codes[] = { GOAL_EQ, GOAL_NE, GOAL_LE, GOAL_GE, GOAL_LT, GOAL_GT };
+    size_t opLength = 0;
+    for (int i = 0; i < 6 && !opLength; i++)
+    {
+        if (s.compare(at, std::strlen(ops[i]), ops[i]) == 0)
+        {
+            goal.op = codes[i];
+            opLength = std::strlen(ops[i]);
+        }
+    }
+    if (!opLength || at + opLength == s.size())
+        return false;
+    char *end;
+    goal.value = std::strtoul(s.c_str() + at + opLength, &end, 0);
+    if (*end)
+        return false;
+
+    goal.where = 0;
+    if (field.size() == 2 && (field[0] == 'V' || field[0] == 'v') && std::isxdigit((unsigned char)field[1]))
+    {
+        goal.field = GOAL_REGISTER;
+        goal.where = std::strtoul(field.c_str() + 1, nullptr, 16);
+    }
+    else if (field == "I")
+        goal.field = GOAL_I;
+    else if (field == "pc")
+        goal.field = GOAL_PC;
+    else if (field == "sp")
+        goal.field = GOAL_SP;
+    else if (field == "dt")
+        goal.field = GOAL_DELAY;
+    else if (field == "st")
+        goal.field = GOAL_SOUND;
+    else if (field.compare(0, 4, "mem[") == 0 && field.back() == ']')
+    {
+        goal.field = GOAL_MEMORY;
+        goal.where = std::strtoul(field.c_str() + 4, &end, 0);
+        if (*end != ']' || goal.where > 0xFFF)
+            return false;
+    }
+    else
+        return false;
+    return true;
+}
+
+static bool reached(const std::vector<Goal> &goals, const Chip8State &state)
+{
+    for (const Goal &goal : goals)
+    {
+        unsigned long value = 0;
+        switch (goal.field)
+        {
+            case GOAL_REGISTER: value = state.registers[goal.where]; break;
+            case GOAL_I:        value = state.I; break;
+            case GOAL_PC:       value = state.pc; break;
+            case GOAL_SP:       value = state.sp; break;
+            case GOAL_DELAY:    value = state.delay_timer; break;
+            case GOAL_SOUND:    value = state.sound_timer; break;
+            case GOAL_MEMORY:   value = state.memory[goal.where]; break;
+        }
+        bool holds = false;
+        switch (goal.op)
+        {
+            case GOAL_EQ: holds = value == goal.value; break;
+            case GOAL_NE: holds = value != goal.value; break;
+            case GOAL_LT: holds = value < goal.value; break;
+            case GOAL_LE: holds = value <= goal.value; break;
+            case GOAL_GT: holds = value > goal.value; break;
+            case GOAL_GE: holds = value >= goal.value; break;
+        }
+        if (!holds)
+            return false;
+    }
+    return true;
+}
+
+// "none", "5" or "4+6"
+static std::string input_name(uint16_t mask)
+{
+    if (!mask)
+        return "none";
+    std::string name;
+    for (int key = 0; key < 16; key++)
+    {
+        if (mask & (1 << key))
+        {
+            if (!name.empty())
+                name += "+";
+            name += "0123456789ABCDEF"[key];
+        }
+    }
+    return name;
+}
+
+static bool parse_inputs(const std::string &text, std::vector<uint16_t> &inputs)
+{
+    inputs.clear();
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t comma = std::min(text.find(',', start), text.size());
+        std::string choice = text.substr(start, comma - start);
+        uint16_t mask = 0;
+        if (choice != "none")
+        {
+            for (size_t i = 0; i < choice.size(); i++)
+            {
+                char c = choice[i];
+                if (i % 2 == 1 ? c != '+' : !std::isxdigit((unsigned char)c))
+                    return false;
+                if (i % 2 == 0)
+                    mask |= 1 << std::strtoul(std::string(1, c).c_str(), nullptr, 16);
+            }
+            if (choice.empty() || choice.back() == '+')
+                return false;
+        }
+        inputs.push_back(mask);
+        start = comma + 1;
+    }
+    return !inputs.empty();
+}
+
+// one thread's share of a level: children not seen before go to children
+static void expand(const Search &search, StateSet &seen, Level &level, std::vector<Node> &children)
+{
+    Chip8 *chip8 = new Chip8();
+    const std::vector<Node> &frontier = *level.frontier;
+    unsigned long expanded = 0, duplicates = 0, pruned = 0;
+    int cycles = search.frames * search.cyclesPerFrame;
+    while (!level.found.load(std::memory_order_relaxed))
+    {
+        size_t begin = level.next.fetch_add(EXPLORE_CHUNK);
+        if (begin >= frontier.size())
+            break;
+        size_t end = std::min(begin + EXPLORE_CHUNK, frontier.size());
+        for (size_t n = begin; n < end; n++)
+        {
+            const Node &node = frontier[n];
+            for (uint16_t input : search.inputs)
+            {
+                chip8->restore(node.state, node.memoryHash, node.screenHash);
+                for (int key = 0; key < 16; key++)
+                    chip8->key[key] = (input >> key) & 1;
+                for (int i = 0; i < cycles; i++)
+                    chip8->cycle();
+                expanded++;
+
+                // the goal is checked first, it counts even where the state
+                // is pruned or another path got there before; the child is
+                // built in place and taken back if it is not kept
+                children.emplace_back();
+                Node &child = children.back();
+                child.state = chip8->state();
+                child.memoryHash = chip8->memory_hash();
+                child.screenHash = chip8->screen_hash();
+                child.parent = n;       // renumbered when the level is merged
+                child.input = input;
+                if (reached(search.goals, child.state))
+                {
+                    std::lock_guard<std::mutex> guard(level.lock);
+                    if (!level.found.load())
+                    {
+                        level.goal = child;
+                        level.found.store(true);
+                    }
+                }
+
+                // a full level is not marked seen, a later path may keep it
+                if (level.kept.load(std::memory_order_relaxed) >= search.maxFrontier)
+                {
+                    children.pop_back();
+                    pruned++;
+                    continue;
+                }
+                if (!seen.insert(chip8->state_hash()))
+                {
+                    children.pop_back();
+                    duplicates++;
+                    continue;
+                }
+                level.kept.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    level.expanded += expanded;
+    level.duplicates += duplicates;
+    level.pruned += pruned;
+    delete chip8;
+}
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <rom> --goal <predicate> [--goal ...] [options]\n"
+              << "  --goal <p>              V0-VF, I, pc, sp, dt, st or mem[addr], then == != < <= > >= and a number\n"
+              << "  --inputs <list>         choices to branch on (default none,0,1,...,F), e.g. none,4,6,4+6\n"
+              << "  --frames <n>            frames each input is held (default " << EXPLORE_FRAMES << ")\n"
+              << "  --cycles-per-frame <n>  instructions per frame (default " << EXPLORE_CYCLES_PER_FRAME << ")\n"
+              << "  --depth <n>             inputs in a sequence at most (default " << EXPLORE_DEPTH << ")\n"
+              << "  --threads <n>           default: one per core\n"
+              << "  --max-frontier <n>      states kept per level, the rest are pruned (default " << EXPLORE_MAX_FRONTIER << ")\n"
+              << "  --max-states <n>        states remembered for deduplication (default " << EXPLORE_MAX_STATES << ")\n"
+              << "  --seed <n>              CXNN random seed (default 1)\n";
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+        usage(argv[0]);
+    Search search;
+    parse_inputs("none,0,1,2,3,4,5,6,7,8,9,A,B,C,D,E,F", search.inputs);
+    uint32_t seed = 1;
+    for (int i = 2; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--goal") == 0 && hasValue)
+        {
+            Goal goal;
+            if (!parse_goal(argv[++i], goal))
+            {
+                std::cerr << "Cannot parse goal " << argv[i] << "\n";
+                usage(argv[0]);
+            }
+            search.goals.push_back(goal);
+        }
+        else if (std::strcmp(argv[i], "--inputs") == 0 && hasValue)
+        {
+            if (!parse_inputs(argv[++i], search.inputs))
+            {
+                std::cerr << "Cannot parse inputs " << argv[i] << "\n";
+                usage(argv[0]);
+            }
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+            search.frames = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--cycles-per-frame") == 0 && hasValue)
+            search.cyclesPerFrame = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--depth") == 0 && hasValue)
+            search.depth = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+            search.threads = std::strtoul(argv[++i], nullptr, 0);
+        else if (std::strcmp(argv[i], "--max-frontier") == 0 && hasValue)
+            search.maxFrontier = std::max(1ul, std::strtoul(argv[++i], nullptr, 0));
+        else if (std::strcmp(argv[i], "--max-states") == 0 && hasValue)
+            search.maxStates = std::max(1024ul, std::strtoul(argv[++i], nullptr, 0));
+        else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+            seed = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        else
+            usage(argv[0]);
+    }
+    if (search.goals.empty())
+        usage(argv[0]);
+    if (!search.threads)
+        search.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot read " << argv[1] << "\n";
+        return EXIT_FAILURE;
+    }
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Chip8 *boot = new Chip8();
+    boot->seed(seed);
+    boot->load(rom.data(), rom.size());
+
+    // sized so maxStates fit below the load limit
+    StateSet seen((size_t)(search.maxStates / STATE_SET_MAX_LOAD) + 1);
+    std::vector<Node> frontier(1);
+    frontier[0].state = boot->state();
+    frontier[0].memoryHash = boot->memory_hash();
+    frontier[0].screenHash = boot->screen_hash();
+    frontier[0].parent = NO_PARENT;
+    frontier[0].input = 0;
+    seen.insert(boot->state_hash());
+    delete boot;
+    // links[i] is how node i was reached, the root is 0
+    std::vector<Link> links(1, Link{NO_PARENT, 0});
+    std::vector<uint32_t> ids(1, 0);
+
+    bool found = reached(search.goals, frontier[0].state);
+    Node goal = frontier[0];
+    unsigned long expanded = 0, duplicates = 0, pruned = 0;
+    size_t peakFrontier = 1;
+    auto start = std::chrono::steady_clock::now();
+    for (int depth = 1; depth <= search.depth && !found && !frontier.empty() && !seen.full(); depth++)
+    {
+        Level level;
+        level.frontier = &frontier;
+        std::vector<std::vector<Node>> children(search.threads);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < search.threads; t++)
+            workers.emplace_back(expand, std::cref(search), std::ref(seen), std::ref(level), std::ref(children[t]));
+        for (std::thread &worker : workers)
+            worker.join();
+
+        // number the new states after the ones before them
+        std::vector<Node> next;
+        std::vector<uint32_t> nextIds;
+        for (std::vector<Node> &part : children)
+        {
+            for (Node &child : part)
+            {
+                links.push_back(Link{ids[child.parent], child.input});
+                nextIds.push_back(links.size() - 1);
+                next.push_back(child);
+            }
+            std::vector<Node>().swap(part);
+        }
+        peakFrontier = std::max(peakFrontier, frontier.size() + next.size());
+        std::cout << "depth " << depth << ": " << frontier.size() << " states expanded into " << level.expanded
+                  << ", " << next.size() << " new, " << level.duplicates << " seen before, " << level.pruned << " pruned\n";
+        expanded += level.expanded;
+        duplicates += level.duplicates;
+        pruned += level.pruned;
+        if (level.found)
+        {
+            found = true;
+            goal = level.goal;
+            goal.parent = ids[goal.parent];
+        }
+        frontier.swap(next);
+        ids.swap(nextIds);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (found)
+    {
+        std::vector<uint16_t> path;
+        if (goal.parent != NO_PARENT)
+        {
+            path.push_back(goal.input);
+            for (uint32_t id = goal.parent; links[id].parent != NO_PARENT; id = links[id].parent)
+                path.push_back(links[id].input);
+        }
+        std::reverse(path.begin(), path.end());
+        std::cout << "goal reached after " << path.size() << " inputs (" << path.size() * search.frames
+                  << " frames, " << path.size() * search.frames * search.cyclesPerFrame << " instructions):\n";
+        for (size_t i = 0; i < path.size(); i++)
+            std::cout << "  " << i + 1 << ": " << input_name(path[i]) << " for " << search.frames << " frames\n";
+        print_state(std::cout, goal.state);
+    }
+    else
+    {
+        std::cout << "goal not reached";
+        if (seen.full())
+            std::cout << ", the state set is full (--max-states)";
+        if (pruned)
+            std::cout << ", " << pruned << " states were pruned (--max-frontier)";
+        std::cout << "\n";
+    }
+
+    struct rusage resources;
+    getrusage(RUSAGE_SELF, &resources);
+    std::cout << expanded << " states expanded in " << seconds << " s on " << search.threads << " threads, "
+              << expanded / seconds << " states/s; " << seen.size() << " unique, " << duplicates << " seen before\n"
+              << "memory: state set " << seen.bytes() / 1048576.0 << " MiB, peak frontier "
+              << peakFrontier * sizeof(Node) / 1048576.0 << " MiB, links " << links.size() * sizeof(Link) / 1048576.0
+              << " MiB, max RSS " << resources.ru_maxrss / 1024.0 << " MiB\n";
+    return found ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,81 @@
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "file_watcher.hpp"
+
+FileWatcher::~FileWatcher(){
+    if(thread.joinable()){
+        char byte = 0;
+        if(write(wake[1], &byte, 1) == 1){
+            thread.join();
+        }
+        else{
+            thread.detach();
+        }
+    }
+    for(int end : wake){
+        if(end >= 0){
+            close(end);
+        }
+    }
+    if(fd >= 0){
+        close(fd);
+    }
+}
+
+bool FileWatcher::watch(const std::string &directory){
+    if(fd < 0){
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(fd < 0){
+            return false;
+        }
+    }
+    // editors either rewrite a file in place or move a new one over it
+    int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(wd < 0){
+        return false;
+    }
+    std::string prefix = directory;
+    if(!prefix.empty() && prefix.back() != '/'){
+        prefix += '/';
+    }
+    directories[wd] = prefix;
+    return true;
+}
+
+bool FileWatcher::start(){
+    if(fd < 0 || pipe(wake) != 0){
+        return false;
+    }
+    thread = std::thread(&FileWatcher::run, this);
+    return true;
+}
+
+std::vector<std::string> FileWatcher::take_changes(){
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<std::string> changed(changes.begin(), changes.end());
+    changes.clear();
+    return changed;
+}
+
+void FileWatcher::run(){
+    alignas(struct inotify_event) char buffer[4096];
+    struct pollfd fds[2] = {
+        { fd, POLLIN, 0 },
+        { wake[0], POLLIN, 0 },
+    };
+    while(poll(fds, 2, -1) >= 0 && !(fds[1].revents & POLLIN)){
+        ssize_t length;
+        while((length = read(fd, buffer, sizeof(buffer))) > 0){
+            std::lock_guard<std::mutex> guard(lock);
+            for(char *p = buffer; p < buffer + length; ){
+                struct inotify_event *event = (struct inotify_event*)p;
+                if(event->len && directories.count(event->wd)){
+                    changes.insert(directories[event->wd] + event->name);
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// watches directories with inotify on a background thread and collects the
+// paths of files written or replaced in them. The render loop picks the
+// changes up with take_changes(), which never blocks on the file system.
+class FileWatcher {
+    public:
+        ~FileWatcher();
+        bool watch(const std::string &directory);   // call before start()
+        bool start();
+        std::vector<std::string> take_changes();     // paths changed since the last call
+
+    private:
+        void run();
+
+        int fd{-1};
+        int wake[2]{-1, -1};                // pipe used to stop the thread
+        std::map<int, std::string> directories;
+        std::thread thread;
+        std::mutex lock;
+        std::set<std::string> changes;
+};
+
+#endif
@@ -0,0 +1,231 @@
+#include <ctime>
+
+#include "frame_capture.hpp"
+#include "gl_util.hpp"
+
+#define SAMPLE_PERIOD std::chrono::microseconds(1000000 / VIDEO_FPS)
+
+std::string timestamped(const char *prefix){
+    char stamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+    return std::string(prefix) + "-" + stamp;
+}
+
+FrameCapture::~FrameCapture(){
+    stop_recording();
+    while(retired < issued){
+        retire(true);
+    }
+    delete shots;
+    if(pbo[0]){
+        glDeleteBuffers(CAPTURE_RING_SIZE, pbo);
+    }
+}
+
+void FrameCapture::screenshot(){
+    shot_requested = true;
+}
+
+bool FrameCapture::start_recording(const std::string &path){
+    if(recording()){
+        return true;
+    }
+    bool y4m = path.size() > 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+    if(!y4m && !frame_pattern(path)){
+        std::cerr << "Cannot record to " << path << " (expected a .y4m file or a pattern with one %d, like %05d)\n";
+        return false;
+    }
+    // the writer is opened on the next frame, once the window size is known
+    record_path = path;
+    record_width = record_height = 0;
+    next_sample = clock::now();
+    std::cout << "recording to " << path << std::endl;
+    return true;
+}
+
+void FrameCapture::stop_recording(){
+    if(!recording()){
+        return;
+    }
+    // pending readbacks still belong to the recording
+    while(retired < issued){
+        retire(true);
+    }
+    if(recorder){
+        recorder->close();
+        recorder->report(std::cout);
+        delete recorder;
+        recorder = nullptr;
+    }
+    record_path.clear();
+}
+
+void FrameCapture::frame_drawn(int width, int height, unsigned int framebuffer){
+    clock::time_point start = clock::now();
+    frame++;
+
+    // deliver readbacks old enough that the GPU has finished them, never waiting on one
+    while(retired < issued && frame - slots[retired % CAPTURE_RING_SIZE].frame >= CAPTURE_DELAY && retire(false)){
+    }
+
+    bool record = false;
+    int missed = 0;
+    if(recording()){
+        if(!recorder){
+            recorder = new VideoWriter();
+            record_width = width;
+            record_height = height;
+            if(!recorder->open(record_path, width, height)){
+                std::cerr << "ERROR::CAPTURE::CANNOT_OPEN " << record_path << std::endl;
+                delete recorder;
+                recorder = nullptr;
+                record_path.clear();
+            }
+        }
+        else if(width != record_width || height != record_height){
+            std::cout << "window resized, recording stopped" << std::endl;
+            stop_recording();
+        }
+    }
+    if(recording() && start >= next_sample){
+        // sample at 60 Hz; periods the loop was too slow for repeat this frame
+        record = true;
+        next_sample += SAMPLE_PERIOD;
+        while(start >= next_sample){
+            missed++;
+            next_sample += SAMPLE_PERIOD;
+        }
+    }
+    if(shot_requested || record){
+        read_back(width, height, framebuffer, shot_requested, record);
+        slots[(issued - 1) % CAPTURE_RING_SIZE].repeats = missed;
+        shot_requested = false;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    calls++;
+    total_ms += ms;
+    if(ms > max_ms){
+        max_ms = ms;
+    }
+}
+
+void FrameCapture::read_back(int width, int height, unsigned int framebuffer, bool shot, bool record){
+    if(!pbo[0]){
+        glGenBuffers(CAPTURE_RING_SIZE, pbo);
+    }
+    if(issued - retired == CAPTURE_RING_SIZE){
+        retire(true);
+    }
+    int index = issued % CAPTURE_RING_SIZE;
+    Slot &slot = slots[index];
+    slot.width = width;
+    slot.height = height;
+    slot.screenshot = shot;
+    slot.record = record;
+    slot.repeats = 0;
+    slot.frame = frame;
+
+    size_t size = (size_t)width * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[index]);
+    if(pbo_size[index] < size){
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        pbo_size[index] = size;
+    }
+    // the copy into the buffer runs on the GPU, glReadPixels returns at once
+    gl_state().bind_framebuffer(framebuffer);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    issued++;
+    readbacks++;
+}
+
+bool FrameCapture::retire(bool wait){
+    int index = retired % CAPTURE_RING_SIZE;
+    Slot &slot = slots[index];
+    if(!slot.pixels){
+        if(glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED){
+            if(!wait){
+                return false;
+            }
+            stalls++;
+            glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+
+        size_t size = (size_t)slot.width * slot.height * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[index]);
+        slot.pixels = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.recorded = slot.shot = false;
+        if(!slot.pixels){
+            retired++;
+            return true;
+        }
+    }
+    // the writers read the mapping on their threads, so it stays mapped until they are done
+    if(!deliver(slot, wait) || !released(slot, wait)){
+        return false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[index]);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.pixels = nullptr;
+    retired++;
+    return true;
+}
+
+// hands the mapped pixels to the writers that want them; false if one had
+// no room and wait is not set, to try again next frame
+bool FrameCapture::deliver(Slot &slot, bool wait){
+    if(slot.record && recorder && !slot.recorded){
+        if(!recorder->submit_rows(slot.pixels, slot.repeats, wait, slot.record_ticket)){
+            return false;
+        }
+        slot.recorded = true;
+    }
+    if(slot.screenshot && !slot.shot){
+        // one writer per window size, numbered from the time it was opened
+        if(!shots || shot_width != slot.width || shot_height != slot.height){
+            delete shots;
+            shots = new VideoWriter();
+            shot_width = slot.width;
+            shot_height = slot.height;
+            shots->open(timestamped("screenshot") + "-%d.png", shot_width, shot_height);
+        }
+        if(!shots->submit_rows(slot.pixels, 0, wait, slot.shot_ticket)){
+            return false;
+        }
+        slot.shot = true;
+        std::cout << "screenshot taken" << std::endl;
+    }
+    return true;
+}
+
+bool FrameCapture::released(Slot &slot, bool wait){
+    VideoWriter *writers[2] = { slot.recorded ? recorder : nullptr, slot.shot ? shots : nullptr };
+    unsigned long tickets[2] = { slot.record_ticket, slot.shot_ticket };
+    for(int i = 0; i < 2; i++){
+        if(writers[i] && !writers[i]->released(tickets[i])){
+            if(!wait){
+                return false;
+            }
+            writers[i]->wait_released(tickets[i]);
+        }
+    }
+    return true;
+}
+
+void FrameCapture::report(std::ostream &out) const{
+    if(!readbacks){
+        return;
+    }
+    out << "capture: " << readbacks << " readbacks, " << stalls << " fence waits";
+    if(calls){
+        out << ", avg " << total_ms / calls << " ms, max " << max_ms << " ms per frame";
+    }
+    out << "\n";
+}
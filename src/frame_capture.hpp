@@ -0,0 +1,75 @@
+#ifndef FRAME_CAPTURE_HPP
+#define FRAME_CAPTURE_HPP
+#include <glad/glad.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "video_writer.hpp"
+
+#define CAPTURE_RING_SIZE 3
+#define CAPTURE_DELAY 2             // frames between a readback and mapping it
+
+// reads the finished window image back without stalling the pipeline.
+// glReadPixels targets a pixel buffer object and a fence marks when the copy
+// is done; the buffer is mapped CAPTURE_DELAY frames later, by which time the
+// GPU has long finished, and handed to VideoWriter's thread, which flips it
+// out of the mapping. The render thread unmaps the buffer once the writer is
+// done with it and never waits for the writer unless it is a whole ring
+// behind. Recording samples the window at 60 Hz and repeats frames the
+// render loop was too slow to produce.
+class FrameCapture {
+    public:
+        ~FrameCapture();
+        void screenshot();                              // PNG of the next frame
+        bool start_recording(const std::string &path);  // .y4m or PNG pattern
+        void stop_recording();
+        bool recording() const { return record_path.size() > 0; }
+        void frame_drawn(int width, int height, unsigned int framebuffer = 0);  // after drawing, before the swap
+        void report(std::ostream &out) const;
+
+    private:
+        typedef std::chrono::steady_clock clock;
+        struct Slot {
+            GLsync fence{};
+            int width{}, height{};
+            bool screenshot{};
+            bool record{};
+            int repeats{};                  // recorded frames missed after this one
+            unsigned long frame{};          // when the readback was issued
+            const uint8_t *pixels{};        // mapped, until the writers release it
+            bool recorded{}, shot{};        // handed to the writers
+            unsigned long record_ticket{}, shot_ticket{};
+        };
+
+        void read_back(int width, int height, unsigned int framebuffer, bool shot, bool record);
+        bool retire(bool wait);             // deliver the oldest pending slot
+        bool deliver(Slot &slot, bool wait);
+        bool released(Slot &slot, bool wait);
+
+        unsigned int pbo[CAPTURE_RING_SIZE]{};
+        size_t pbo_size[CAPTURE_RING_SIZE]{};
+        Slot slots[CAPTURE_RING_SIZE];
+        unsigned long issued{};             // readbacks started
+        unsigned long retired{};            // readbacks delivered
+        unsigned long frame{};              // frame_drawn calls
+
+        bool shot_requested{};
+        VideoWriter *shots{};
+        int shot_width{}, shot_height{};
+        std::string record_path;
+        VideoWriter *recorder{};
+        int record_width{}, record_height{};
+        clock::time_point next_sample;
+
+        unsigned long readbacks{};
+        unsigned long stalls{};             // had to wait for a fence
+        unsigned long calls{};
+        double total_ms{};
+        double max_ms{};
+};
+
+// prefix plus the local time, e.g. screenshot-20240101-120000
+std::string timestamped(const char *prefix);
+
+#endif
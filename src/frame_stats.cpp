@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+#include "frame_stats.hpp"
+
+void RollingTiming::add(double ms){
+    samples[next] = (float)ms;
+    next = (next + 1) % FRAME_STATS_WINDOW;
+    total++;
+}
+
+double RollingTiming::last() const{
+    return total ? samples[(next + FRAME_STATS_WINDOW - 1) % FRAME_STATS_WINDOW] : 0.0;
+}
+
+double RollingTiming::average() const{
+    size_t n = std::min(total, (unsigned long)FRAME_STATS_WINDOW);
+    if(n == 0){
+        return 0.0;
+    }
+    double sum = 0.0;
+    for(size_t i = 0; i < n; i++){
+        sum += samples[i];
+    }
+    return sum / n;
+}
+
+double RollingTiming::percentile(double p) const{
+    size_t n = std::min(total, (unsigned long)FRAME_STATS_WINDOW);
+    if(n == 0){
+        return 0.0;
+    }
+    // the window is not in time order once it wrapped, which rank ignores
+    std::vector<float> sorted(samples, samples + n);
+    size_t rank = (size_t)(p / 100.0 * (n - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+RollingTiming& FrameStats::timing(const std::string &name){
+    for(Entry &entry : timings){
+        if(entry.name == name){
+            return entry.timing;
+        }
+    }
+    timings.push_back(Entry{ name, RollingTiming() });
+    return timings.back().timing;
+}
+
+bool FrameStats::log_due(){
+    clock::time_point now = clock::now();
+    if(now - last_log < std::chrono::seconds(FRAME_STATS_LOG_SECONDS)){
+        return false;
+    }
+    last_log = now;
+    return true;
+}
+
+void FrameStats::log(std::ostream &out) const{
+    std::ios::fmtflags flags = out.flags();
+    out << "frame ms (avg/p95):" << std::fixed << std::setprecision(3);
+    for(const Entry &entry : timings){
+        if(entry.timing.count()){
+            out << "  " << entry.name << " " << entry.timing.average() << "/" << entry.timing.percentile(95.0);
+        }
+    }
+    out << std::endl;
+    out.flags(flags);
+}
+
+void FrameStats::report(std::ostream &out) const{
+    out << "frame timings over the last " << FRAME_STATS_WINDOW << " samples:\n" << std::fixed << std::setprecision(3);
+    for(const Entry &entry : timings){
+        const RollingTiming &t = entry.timing;
+        out << "  " << std::setw(24) << std::left << entry.name << std::right;
+        if(!t.count()){
+            out << "  no samples\n";
+            continue;
+        }
+        out << " avg " << std::setw(7) << t.average()
+            << "  p50 " << std::setw(7) << t.percentile(50.0)
+            << "  p95 " << std::setw(7) << t.percentile(95.0)
+            << "  p99 " << std::setw(7) << t.percentile(99.0) << " ms"
+            << "  (" << t.count() << " samples)\n";
+    }
+}
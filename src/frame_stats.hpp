@@ -0,0 +1,78 @@
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <string>
+
+#define FRAME_STATS_WINDOW 600          // samples kept per timing, 10 s at 60 Hz
+#define FRAME_STATS_LOG_SECONDS 5       // between log lines
+
+// the most recent FRAME_STATS_WINDOW samples of one timing
+class RollingTiming {
+    public:
+        void add(double ms);
+        unsigned long count() const { return total; }
+        double last() const;
+        double average() const;
+        double percentile(double p) const;  // nearest rank over the window
+
+    private:
+        float samples[FRAME_STATS_WINDOW]{};
+        int next{};                         // slot written by the next add()
+        unsigned long total{};
+};
+
+// where a frame's time goes, by name: main times input, emulation, upload,
+// draw submission and present on the CPU, and the GL renderer feeds in its
+// GPU timer results for the texture upload and each post-processing pass.
+class FrameStats {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        RollingTiming& timing(const std::string &name);    // added on first use
+        bool log_due();                     // true every FRAME_STATS_LOG_SECONDS
+        void log(std::ostream &out) const;  // one line of averages and p95
+        void report(std::ostream &out) const;
+
+        // loop counters kept by main
+        unsigned long cycles{};             // instructions executed
+        unsigned long loops{};              // main loop iterations
+        unsigned long idle_loops{};         // iterations that skipped the cycle
+
+        template<typename F>
+        void for_each(F f) const{
+            for(const Entry &entry : timings){
+                f(entry.name, entry.timing);
+            }
+        }
+
+    private:
+        struct Entry {
+            std::string name;
+            RollingTiming timing;
+        };
+        std::deque<Entry> timings;          // stable addresses, in order of first use
+        clock::time_point last_log{clock::now()};
+};
+
+// adds the CPU time spent in a scope to a timing; does nothing without one
+class ScopedTiming {
+    public:
+        ScopedTiming(RollingTiming *timing) : timing(timing){
+            if(timing){
+                start = FrameStats::clock::now();
+            }
+        }
+        ~ScopedTiming(){
+            if(timing){
+                timing->add(std::chrono::duration<double, std::milli>(FrameStats::clock::now() - start).count());
+            }
+        }
+
+    private:
+        RollingTiming *timing;
+        FrameStats::clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "chip8.hpp"
+#include "chip8_state.hpp"
+
+// fuzz target: arbitrary ROM bytes and key presses run on one Chip8 that is
+// restored from a snapshot before each input, so an input costs a memory
+// copy instead of a construction. Input layout:
+//   byte 0        number of key frames k
+//   2k bytes      key masks, bit n holds key n, each for FUZZ_CYCLES_PER_KEYS instructions
+//   the rest      ROM loaded at 0x200
+// Runs stop after FUZZ_MAX_CYCLES instructions, so FX0A waiting for a key
+// or a ROM spinning on itself cannot stall the fuzzer. Each run ends with a
+// check of the incremental state hash against one from scratch.
+#define FUZZ_MAX_CYCLES 10000
+#define FUZZ_CYCLES_PER_KEYS 500
+
+// seeded, so CXNN and with it every run repeats across processes
+static Chip8* seeded_chip8()
+{
+    Chip8 *chip8 = new Chip8();
+    chip8->seed(1);
+    return chip8;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static Chip8 *chip8 = seeded_chip8();
+    static const Chip8State boot = chip8->state();
+    static const uint64_t bootMemory = chip8->memory_hash(), bootScreen = chip8->screen_hash();
+    if (size == 0)
+        return 0;
+
+    size_t keyFrames = std::min((size_t)data[0], (size - 1) / 2);
+    const uint8_t *keys = data + 1;
+    const uint8_t *rom = keys + keyFrames * 2;
+    chip8->restore(boot, bootMemory, bootScreen);
+    chip8->load(rom, size - (rom - data));
+
+    for (int cycle = 0; cycle < FUZZ_MAX_CYCLES; cycle++)
+    {
+        if (cycle % FUZZ_CYCLES_PER_KEYS == 0)
+        {
+            size_t frame = cycle / FUZZ_CYCLES_PER_KEYS;
+            uint16_t mask = frame < keyFrames ? keys[frame * 2] << 8 | keys[frame * 2 + 1] : 0;
+            for (int key = 0; key < 16; key++)
+                chip8->key[key] = (mask >> key) & 1;
+        }
+        chip8->cycle();
+    }
+
+    // the hashes kept while running have to match ones worked out afresh
+    if (chip8->state_hash() != state_hash(chip8->state()))
+    {
+        std::cerr << "ERROR::FUZZ::STATE_HASH_MISMATCH\n";
+        std::abort();
+    }
+    return 0;
+}
+
+#ifdef CHIP8_FUZZ_DRIVER
+// stand-in for libFuzzer where it is missing (gcc): replays corpus files and
+// directories, or runs random inputs with --random <n> [--seed <s>]
+static bool replay(const std::string &path, unsigned long &inputs)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+    if (S_ISDIR(info.st_mode))
+    {
+        DIR *dir = opendir(path.c_str());
+        if (!dir)
+            return false;
+        bool ok = true;
+        while (dirent *entry = readdir(dir))
+            if (entry->d_name[0] != '.')
+                ok &= replay(path + "/" + entry->d_name, inputs);
+        closedir(dir);
+        return ok;
+    }
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+    inputs++;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long inputs = 0, randomInputs = 0;
+    uint32_t seed = 1;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--random") == 0 && i + 1 < argc)
+            randomInputs = std::strtoul(argv[++i], nullptr, 0);
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        else
+            paths.push_back(argv[i]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string &path : paths)
+    {
+        if (!replay(path, inputs))
+        {
+            std::cerr << "Cannot read " << path << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    std::mt19937 random(seed);
+    std::vector<uint8_t> data;
+    for (unsigned long n = 0; n < randomInputs; n++)
+    {
+        data.resize(1 + random() % 1024);
+        for (uint8_t &byte : data)
+            byte = random() & 0xFF;
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+        inputs++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << inputs << " inputs in " << seconds << " s, " << inputs / seconds << " exec/s\n";
+    return 0;
+}
+#endif
@@ -0,0 +1,218 @@
+#include "gl_renderer.hpp"
+#include "gl_util.hpp"
+#include "graphics.hpp"
+#include "program_cache.hpp"
+#include "shader_source.hpp"
+#include "trace.hpp"
+
+GlRenderer::~GlRenderer(){
+    release();
+    if(window){
+        glfwTerminate();
+    }
+}
+
+void GlRenderer::release(){
+    delete capture;
+    delete hud;
+    delete heatmap;
+    delete screen;
+    delete chain;
+    delete watcher;
+    capture = nullptr;
+    hud = nullptr;
+    heatmap = nullptr;
+    screen = nullptr;
+    chain = nullptr;
+    watcher = nullptr;
+}
+
+bool GlRenderer::open_context(const Options&, StartupTimer &startup){
+    window = setup_window(30, &startup);
+    loader = (GLADloadproc)glfwGetProcAddress;
+    if(!window){
+        return false;
+    }
+    glfwSwapInterval(0);
+    return true;
+}
+
+void GlRenderer::output_size(int &width, int &height){
+    glfwGetFramebufferSize(window, &width, &height);
+}
+
+bool GlRenderer::init(const Options &options, StartupTimer &startup){
+    upload_stats = options.upload_stats;
+    pass_stats = options.pass_stats;
+
+    // create window
+    if(!open_context(options, startup)){
+        return false;
+    }
+    gl_state().reset();
+
+    // create VAO for rendering
+    vao = make_VAO();
+
+    // build and compile the post-processing passes, reusing cached program binaries
+    if(options.shader_cache){
+        program_cache_init(loader);
+    }
+    chain = new PostChain();
+    if(!chain->load(options.preset, vao)){
+        return false;
+    }
+    chain->set_budget(options.gpu_budget);
+    startup.mark("shader compile");
+
+    // watch the shader directory so edited passes are rebuilt while running
+    if(options.hot_reload){
+        watcher = new FileWatcher();
+        if(!watcher->watch(shader_source_directory()) || !watcher->start()){
+            std::cerr << "Cannot watch " << shader_source_directory() << " for changes\n";
+        }
+    }
+
+    // stream the chip 8 screen into a texture through mapped pixel buffers
+    screen = new TextureStream();
+    if(!screen->init(VIDEO_WIDTH, VIDEO_HEIGHT, loader)){
+        std::cerr << "ERROR::TEXTURE_STREAM::INIT_FAILED" << std::endl;
+        return false;
+    }
+
+    // read the finished frames back for screenshots and recording
+    capture = new FrameCapture();
+    record_path = options.record ? options.record : "";
+    if(options.record){
+        capture->start_recording(record_path);
+    }
+
+    // performance overlay, drawn after capture so recordings stay clean
+    // a frame without it is still a frame, so it only warns
+    hud = new Hud();
+    if(!hud->init()){
+        std::cerr << "ERROR::HUD::INIT_FAILED" << std::endl;
+        delete hud;
+        hud = nullptr;
+    }
+    else if(options.hud){
+        hud->show();
+    }
+    return true;
+}
+
+bool GlRenderer::should_close(){
+    return glfwWindowShouldClose(window);
+}
+
+void GlRenderer::process_input(Chip8 &chip8, LatencyTracker *latency){
+    {
+        TRACE_SCOPE("glfwPollEvents");
+        glfwPollEvents();
+    }
+    {
+        TRACE_SCOPE("processInput");
+        processInput(window, &chip8, latency);
+    }
+
+    // capture keys act on the press only
+    bool shot = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+    if(shot && !shot_key){
+        capture->screenshot();
+    }
+    shot_key = shot;
+    bool record = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+    if(record && !record_key){
+        if(capture->recording()){
+            capture->stop_recording();
+        }
+        else{
+            // without --record each recording gets its own file
+            capture->start_recording(record_path.empty() ? timestamped("recording") + ".y4m" : record_path);
+        }
+    }
+    record_key = record;
+    bool overlay = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+    if(overlay && !hud_key && hud){
+        hud->toggle();
+    }
+    hud_key = overlay;
+    bool heat = glfwGetKey(window, GLFW_KEY_F2) == GLFW_PRESS;
+    if(heat && !heatmap_key && heatmap){
+        heatmap->toggle();
+    }
+    heatmap_key = heat;
+}
+
+void GlRenderer::upload(const Chip8 &chip8){
+    // write straight into the mapped buffer
+    uint8_t *pixels = screen->begin_upload();
+    if(pixels){
+        chip8.expand_screen(pixels);
+        upload_timer.begin();
+        screen->end_upload();
+        upload_timer.end();
+    }
+}
+
+void GlRenderer::draw(){
+    // start rebuilding edited shaders, the chain swaps them in once linked
+    if(watcher){
+        std::vector<std::string> changed = watcher->take_changes();
+        for(std::string &path : changed){
+            path = shader_source_name(path);
+        }
+        if(!changed.empty()){
+            chain->reload(changed);
+        }
+    }
+
+    upload_timer.poll();
+
+    int width, height;
+    output_size(width, height);
+    chain->render(screen->texture(), VIDEO_WIDTH, VIDEO_HEIGHT, width, height, target);
+    capture->frame_drawn(width, height, target);
+    if(hud){
+        hud->draw(width, height);
+    }
+    if(heatmap){
+        heatmap->draw(width, height);
+    }
+}
+
+void GlRenderer::present(){
+    TRACE_SCOPE("glfwSwapBuffers");
+    glfwSwapBuffers(window);
+}
+
+void GlRenderer::set_frame_stats(FrameStats *stats){
+    upload_timer.record_to(&stats->timing("gpu upload"));
+    chain->set_frame_stats(stats);
+    if(hud){
+        hud->set_frame_stats(stats);
+    }
+}
+
+void GlRenderer::set_memory_heat(MemoryHeat *heat){
+    if(!heat){
+        return;
+    }
+    heatmap = new HeatmapView();
+    if(!heatmap->init(heat)){
+        std::cerr << "ERROR::HEATMAP::INIT_FAILED" << std::endl;
+        delete heatmap;
+        heatmap = nullptr;
+    }
+}
+
+void GlRenderer::report(std::ostream &out) const{
+    if(upload_stats){
+        screen->report(out);
+        gl_state().report(out);
+    }
+    if(pass_stats){
+        chain->report(out);
+    }
+    capture->report(out);
+}
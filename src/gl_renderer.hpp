@@ -0,0 +1,57 @@
+#ifndef GL_RENDERER_HPP
+#define GL_RENDERER_HPP
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "renderer.hpp"
+#include "file_watcher.hpp"
+#include "frame_capture.hpp"
+#include "gpu_timer.hpp"
+#include "heatmap_view.hpp"
+#include "hud.hpp"
+#include "postprocess.hpp"
+#include "texture_stream.hpp"
+
+// draws through the post-processing chain into a GLFW window. Binds go
+// through gl_state() so passes that share programs or targets cost nothing.
+// F12 saves a screenshot, F9 starts or stops recording the window, F1
+// shows the performance HUD and F2 the memory heatmap.
+class GlRenderer : public Renderer {
+    public:
+        ~GlRenderer();
+        bool init(const Options &options, StartupTimer &startup) override;
+        bool should_close() override;
+        void process_input(Chip8 &chip8, LatencyTracker *latency) override;
+        void upload(const Chip8 &chip8) override;
+        void draw() override;
+        void present() override;
+        void report(std::ostream &out) const override;
+        void set_frame_stats(FrameStats *stats) override;
+        void set_memory_heat(MemoryHeat *heat) override;
+
+    protected:
+        // the window; OffscreenRenderer swaps in its own context and framebuffer
+        virtual bool open_context(const Options &options, StartupTimer &startup);
+        virtual void output_size(int &width, int &height);
+        void release();                     // delete GL objects while the context still exists
+
+        GLADloadproc loader{};
+        unsigned int target{};              // framebuffer the chain draws into, 0 is the window
+        FrameCapture *capture{};
+        Hud *hud{};
+        HeatmapView *heatmap{};             // only with --heatmap
+
+    private:
+        GLFWwindow *window{};
+        unsigned int vao{};
+        TextureStream *screen{};
+        PostChain *chain{};
+        FileWatcher *watcher{};             // only with --hot-reload
+        GpuTimer upload_timer;              // pixel buffer to texture copy
+        std::string record_path;
+        bool shot_key{}, record_key{}, hud_key{}, heatmap_key{};    // F12, F9, F1 and F2 were down last frame
+        bool upload_stats{};
+        bool pass_stats{};
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include <cstring>
+
+#include "gl_util.hpp"
+
+bool gl_has_extension(const char *name){
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for(int i = 0; i < count; i++){
+        const char *ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if(ext && std::strcmp(ext, name) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+GlState &gl_state(){
+    static GlState state;
+    return state;
+}
+
+// count the call and report whether it needs to reach the driver
+bool GlState::change(bool same){
+    if(same){
+        skipped++;
+        return false;
+    }
+    issued++;
+    return true;
+}
+
+void GlState::use_program(unsigned int id){
+    if(change(program == id)){
+        glUseProgram(id);
+        program = id;
+    }
+}
+
+void GlState::bind_vertex_array(unsigned int id){
+    if(change(vao == id)){
+        glBindVertexArray(id);
+        vao = id;
+    }
+}
+
+void GlState::bind_texture(int unit, unsigned int id){
+    // callers upload through the unit they bound, so it is made active even
+    // when the binding itself is cached
+    if(active_unit != unit){
+        glActiveTexture(GL_TEXTURE0 + unit);
+        active_unit = unit;
+    }
+    if(!change(texture[unit] == id)){
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, id);
+    texture[unit] = id;
+}
+
+void GlState::bind_framebuffer(unsigned int id){
+    if(change(framebuffer == id)){
+        glBindFramebuffer(GL_FRAMEBUFFER, id);
+        framebuffer = id;
+    }
+}
+
+void GlState::viewport(int x, int y, int w, int h){
+    int v[4] = { x, y, w, h };
+    if(change(std::memcmp(view, v, sizeof(v)) == 0)){
+        glViewport(x, y, w, h);
+        std::memcpy(view, v, sizeof(v));
+    }
+}
+
+void GlState::reset(){
+    program = 0;
+    vao = 0;
+    std::memset(texture, 0, sizeof(texture));
+    framebuffer = 0;
+    std::memset(view, 0, sizeof(view));
+
+    // put the context in the state the cache now assumes
+    glUseProgram(0);
+    glBindVertexArray(0);
+    for(int unit = GL_STATE_TEXTURE_UNITS - 1; unit >= 0; unit--){
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    active_unit = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, 0, 0);
+}
+
+void GlState::report(std::ostream &out) const{
+    out << "GL state cache: " << issued << " state changes issued, " << skipped << " redundant ones skipped\n";
+}
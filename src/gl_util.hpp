@@ -0,0 +1,39 @@
+#ifndef GL_UTIL_HPP
+#define GL_UTIL_HPP
+#include <glad/glad.h>
+#include <iostream>
+
+#define GL_STATE_TEXTURE_UNITS 4
+
+// true if the current context advertises the named extension
+bool gl_has_extension(const char *name);
+
+// remembers the bindings made through it and skips calls that would not
+// change anything. Code that binds through raw GL calls must call reset().
+class GlState {
+    public:
+        void use_program(unsigned int program);
+        void bind_vertex_array(unsigned int vao);
+        void bind_texture(int unit, unsigned int texture);     // GL_TEXTURE_2D
+        void bind_framebuffer(unsigned int fbo);                // GL_FRAMEBUFFER
+        void viewport(int x, int y, int w, int h);
+        void reset();                                           // forget everything
+        void report(std::ostream &out) const;
+
+    private:
+        bool change(bool same);
+
+        unsigned int program{};
+        unsigned int vao{};
+        unsigned int texture[GL_STATE_TEXTURE_UNITS]{};
+        int active_unit{};
+        unsigned int framebuffer{};
+        int view[4]{};
+        unsigned long issued{};
+        unsigned long skipped{};
+};
+
+// state cache of the current context
+GlState &gl_state();
+
+#endif
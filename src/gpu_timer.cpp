@@ -0,0 +1,59 @@
+#include "gpu_timer.hpp"
+
+// weight of the newest sample in the moving average
+#define GPU_TIMER_SMOOTHING 0.05
+// first results include shader compilation and driver warm-up, skip them
+#define GPU_TIMER_WARMUP 2
+
+GpuTimer::~GpuTimer(){
+    if(query[0]){
+        glDeleteQueries(GPU_TIMER_QUERIES, query);
+    }
+}
+
+void GpuTimer::begin(){
+    if(!query[0]){
+        glGenQueries(GPU_TIMER_QUERIES, query);
+    }
+    // every query busy: drop this measurement rather than wait
+    if(in_flight[next]){
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query[next]);
+    in_flight[next] = true;
+    active = true;
+}
+
+void GpuTimer::end(){
+    if(!active){
+        return;
+    }
+    active = false;
+    glEndQuery(GL_TIME_ELAPSED);
+    next = (next + 1) % GPU_TIMER_QUERIES;
+}
+
+void GpuTimer::poll(){
+    // results become available in submission order
+    while(in_flight[oldest]){
+        int available = 0;
+        glGetQueryObjectiv(query[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available){
+            break;
+        }
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(query[oldest], GL_QUERY_RESULT, &ns);
+        in_flight[oldest] = false;
+        oldest = (oldest + 1) % GPU_TIMER_QUERIES;
+        if(++seen <= GPU_TIMER_WARMUP){
+            continue;
+        }
+
+        last = ns / 1e6;
+        average = count ? average + GPU_TIMER_SMOOTHING * (last - average) : last;
+        count++;
+        if(history){
+            history->add(last);
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+#include <glad/glad.h>
+
+#include "frame_stats.hpp"
+
+#define GPU_TIMER_QUERIES 4
+
+// times a span of GL commands with GL_TIME_ELAPSED queries. Queries are kept
+// in a small ring and only read back once the driver reports them available,
+// so timing never stalls the pipeline; results lag a few frames behind.
+class GpuTimer {
+    public:
+        ~GpuTimer();
+        void begin();
+        void end();
+        void poll();                        // collect finished queries
+        double last_ms() const { return last; }
+        double average_ms() const { return average; }   // exponential moving average
+        unsigned long samples() const { return count; }
+        void record_to(RollingTiming *timing) { history = timing; }    // also keep every result here
+
+    private:
+        unsigned int query[GPU_TIMER_QUERIES]{};
+        bool in_flight[GPU_TIMER_QUERIES]{};
+        bool active{};                      // between begin() and end()
+        int next{};                         // query used by the next begin()
+        int oldest{};                       // oldest query still in flight
+        double last{};
+        double average{};
+        unsigned long count{};
+        unsigned long seen{};               // results read, including warm-up
+        RollingTiming *history{};
+};
+
+#endif
@@ -1,12 +1,16 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <cstring>
 #include "graphics.hpp"
+#include "gl_util.hpp"
 
 
-GLFWwindow* setup_window(int video_scale){
+GLFWwindow* setup_window(int video_scale, StartupTimer *startup){
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
+    if(startup)
+        startup->mark("GLFW init");
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -22,6 +26,8 @@ GLFWwindow* setup_window(int video_scale){
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    if(startup)
+        startup->mark("window");
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -30,6 +36,8 @@ GLFWwindow* setup_window(int video_scale){
         std::cout << "Failed to initialize GLAD" << std::endl;
         return nullptr;
     }
+    if(startup)
+        startup->mark("glad load");
     return window;  
 }
 
@@ -39,17 +47,19 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    gl_state().viewport(0, 0, width, height);
 }
 
 unsigned int make_VAO(){
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
+    // a quad covering the whole viewport, textured with the chip 8 screen
     float vertices[] = {
-         1.0f/(VIDEO_WIDTH * 1),  1.0f/(VIDEO_HEIGHT * 1), 0.0f,  // top right
-         1.0f/(VIDEO_WIDTH * 1), -1.0f/(VIDEO_HEIGHT * 1), 0.0f,  // bottom right
-        -1.0f/(VIDEO_WIDTH * 1), -1.0f/(VIDEO_HEIGHT * 1), 0.0f,  // bottom left
-        -1.0f/(VIDEO_WIDTH * 1),  1.0f/(VIDEO_HEIGHT * 1), 0.0f   // top left 
+         // positions         // texture coords
+         1.0f,  1.0f, 0.0f,   1.0f, 0.0f,  // top right
+         1.0f, -1.0f, 0.0f,   1.0f, 1.0f,  // bottom right
+        -1.0f, -1.0f, 0.0f,   0.0f, 1.0f,  // bottom left
+        -1.0f,  1.0f, 0.0f,   0.0f, 0.0f   // top left 
     };
     unsigned int indices[] = {  // note that we start from 0!
         0, 1, 3,  // first Triangle
@@ -69,8 +79,10 @@ unsigned int make_VAO(){
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
 
     return VAO;
 
@@ -81,9 +93,16 @@ unsigned int make_VAO(){
 // Q W E R
 // A S D F
 // Z X C V
-void processInput(GLFWwindow *window, Chip8 *chip8)
+void processInput(GLFWwindow *window, Chip8 *chip8, LatencyTracker *latency)
 {
-    
+    // remember key state so changes can be tagged for latency measurement
+    uint8_t previous[16];
+    LatencyTracker::clock::time_point polled;
+    if(latency){
+        std::memcpy(previous, chip8->key, sizeof(previous));
+        polled = LatencyTracker::clock::now();
+    }
+
     // 1 2 3 4
     if(glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS){
         chip8->key[0x0] = 1;
@@ -200,6 +219,10 @@ void processInput(GLFWwindow *window, Chip8 *chip8)
         chip8->key[0xF] = 0;
     }
 
+    if(latency && std::memcmp(previous, chip8->key, sizeof(previous)) != 0){
+        latency->input_event(polled);
+    }
+
     // QUIT
     if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
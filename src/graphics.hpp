@@ -1,13 +1,15 @@
 #ifndef GRAPHICS_HPP
 #define GRAPHICS_HPP
 #include "chip8.hpp"
+#include "latency.hpp"
+#include "startup_timer.hpp"
 
 
     void framebuffer_size_callback(GLFWwindow*, int, int);
     void map_keyboard();
-    GLFWwindow* setup_window(int);
+    GLFWwindow* setup_window(int, StartupTimer *startup = nullptr);
     unsigned int make_VAO();
-    void processInput(GLFWwindow *window, Chip8 *chip8);
+    void processInput(GLFWwindow *window, Chip8 *chip8, LatencyTracker *latency = nullptr);
         
 
 
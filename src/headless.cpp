@@ -0,0 +1,199 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "chip8.hpp"
+#include "chip8_state.hpp"
+#include "movie.hpp"
+#include "opcode_profile.hpp"
+#include "options.hpp"
+#include "soft_raster.hpp"
+#include "trace.hpp"
+#include "video_writer.hpp"
+
+// runs a ROM as fast as possible without a window and records every 60 Hz
+// frame through the software rasterizer. With --replay it plays an input
+// movie back instead, key changes on their exact instructions, checks the
+// recorded state hashes and stops at the end of the movie.
+#define HEADLESS_DEFAULT_FRAMES 600
+#define HEADLESS_DEFAULT_CYCLES 10
+#define FRAME_MS (1000.0 / VIDEO_FPS)
+
+int main(int argc, char** argv)
+{
+    Options options;
+    parse_options(argc, argv, options);
+    if (options.trace)
+    {
+        trace_start(options.trace);
+        trace_thread_name("main");
+    }
+    long frames = options.frames ? options.frames : HEADLESS_DEFAULT_FRAMES;
+
+    // the interactive frontend runs one instruction per cycle delay
+    int cyclesPerFrame = options.cycles_per_frame;
+    if (cyclesPerFrame <= 0)
+        cyclesPerFrame = options.cycle_delay > 0 ? (int)(FRAME_MS / options.cycle_delay + 0.5) : HEADLESS_DEFAULT_CYCLES;
+    if (cyclesPerFrame <= 0)
+        cyclesPerFrame = 1;
+
+    SoftRaster raster;
+    if (!raster.init(VIDEO_WIDTH, VIDEO_HEIGHT, options.scale))
+    {
+        std::cerr << "Scale must be between 1 and " << SOFT_RASTER_MAX_SCALE << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    raster.set_palette(options.palette_off, options.palette_on);
+    raster.set_persistence(options.phosphor);
+
+    VideoWriter *writer = nullptr;
+    if (options.record)
+    {
+        writer = new VideoWriter();
+        if (!writer->open(options.record, raster.width(), raster.height()))
+        {
+            std::cerr << "Cannot record to " << options.record << " (expected a .y4m file or a pattern with one %d, like %05d)\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    Chip8 *chip8 = new Chip8();
+    chip8->loadROM(options.rom);
+    if (options.seed)
+        chip8->seed(options.seed);
+    OpcodeProfile *profile = options.opcode_stats ? new OpcodeProfile() : nullptr;
+    TraceDrawBursts *drawBursts = trace_enabled() ? new TraceDrawBursts() : nullptr;
+    auto run = [&](unsigned long n)
+    {
+        if (profile && drawBursts)
+        {
+            ProfilePair<OpcodeProfile, TraceDrawBursts> both{*profile, *drawBursts};
+            for (unsigned long i = 0; i < n; i++)
+                chip8->step(both);
+        }
+        else if (profile)
+            for (unsigned long i = 0; i < n; i++)
+                chip8->step(*profile);
+        else if (drawBursts)
+            for (unsigned long i = 0; i < n; i++)
+                chip8->step(*drawBursts);
+        else
+            for (unsigned long i = 0; i < n; i++)
+                chip8->cycle();
+        if (drawBursts)
+            drawBursts->flush();
+    };
+
+    Movie movie;
+    MoviePlayer *player = nullptr;
+    if (options.replay)
+    {
+        uint64_t romHash = 0;
+        if (!load_movie(options.replay, movie))
+            std::exit(EXIT_FAILURE);
+        if (!rom_file_hash(options.rom, romHash) || romHash != movie.rom_hash)
+        {
+            std::cerr << options.replay << " was recorded with a different ROM than " << options.rom << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+        player = new MoviePlayer(movie);
+        player->start(*chip8);
+        if (!options.frames)
+            frames = (long)((movie.cycles + cyclesPerFrame - 1) / cyclesPerFrame) + 1;
+    }
+
+    uint8_t screen[VIDEO_WIDTH * VIDEO_HEIGHT];
+    uint64_t shownHash = 0;
+    bool fading = false;
+    size_t frameBytes = (size_t)raster.width() * raster.height() * sizeof(uint32_t);
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (long frame = 0; frame < frames; frame++)
+    {
+        trace_poll();
+        if (player && player->finished())
+        {
+            frames = frame;
+            break;
+        }
+        {
+            TRACE_SCOPE("emulate");
+            if (player)
+            {
+                unsigned long left = cyclesPerFrame;
+                while (left && !player->finished())
+                {
+                    unsigned long n = player->apply(*chip8, left);
+                    run(n);
+                    player->advance(n);
+                    left -= n;
+                }
+            }
+            else
+                run(cyclesPerFrame);
+        }
+        // a replay without video only needs the machine
+        if (player && !writer)
+            continue;
+
+        // a draw that left the screen as it was (XOR twice) is still a repeat
+        bool changed = frame == 0 || (chip8->draw_flag && chip8->screen_hash() != shownHash);
+        chip8->draw_flag = false;
+        if (!changed && !fading)
+        {
+            if (writer)
+                writer->repeat_frame();
+            continue;
+        }
+        if (changed)
+        {
+            chip8->expand_screen(screen);
+            shownHash = chip8->screen_hash();
+        }
+        {
+            TRACE_SCOPE("raster");
+            fading = raster.render(screen, 1.0f / VIDEO_FPS);
+        }
+        if (writer)
+        {
+            TRACE_SCOPE("submit");
+            std::memcpy(writer->begin_frame(), raster.pixels(), frameBytes);
+            writer->end_frame();
+        }
+    }
+    double emulated = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if (writer)
+        writer->close();
+    trace_stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << frames << " frames (" << frames / (double)VIDEO_FPS << " s at " << cyclesPerFrame
+              << " cycles per frame) in " << seconds << " s, " << frames / (double)VIDEO_FPS / seconds
+              << "x real time; emulation and raster alone " << emulated << " s\n";
+    if (writer)
+        writer->report(std::cout);
+    if (profile)
+        profile->report(std::cout);
+    int status = 0;
+    if (player)
+    {
+        if (player->mismatch())
+        {
+            std::cout << "replay diverged at instruction " << player->position() << ": state hash " << std::hex
+                      << chip8->state_hash() << ", recorded " << player->expected_hash() << std::dec << "\n";
+            print_state(std::cout, chip8->state());
+            status = EXIT_FAILURE;
+        }
+        else
+            std::cout << "replayed " << player->position() << " of " << movie.cycles << " instructions, "
+                      << player->checked() << " checkpoints matched, " << player->position() / emulated
+                      << " instructions/s\n";
+    }
+
+    delete writer;
+    delete chip8;
+    delete profile;
+    delete drawBursts;
+    delete player;
+    return status;
+}
@@ -0,0 +1,82 @@
+#include <cstddef>
+
+#include "heatmap_view.hpp"
+#include "gl_util.hpp"
+
+HeatmapView::~HeatmapView(){
+    if(shader){
+        glDeleteProgram(shader->ID);
+        delete shader;
+    }
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+bool HeatmapView::init(MemoryHeat *heat){
+    source = heat;
+    glGenTextures(1, &texture);
+    gl_state().bind_texture(0, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, HEAT_SIDE, HEAT_SIDE, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // same vertex layout as the HUD
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    gl_state().bind_vertex_array(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glEnableVertexAttribArray(2);
+
+    shader = new Shader("hud.vert", "heatmap.frag");
+    last_frame = std::chrono::steady_clock::now();
+    return shader->ID != 0;
+}
+
+void HeatmapView::draw(int width, int height){
+    // counts keep accumulating while hidden and show up at once when shown
+    if(!visible){
+        return;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    float frame_time = std::chrono::duration<float>(now - last_frame).count();
+    last_frame = now;
+    source->render(pixels, frame_time);
+    gl_state().bind_texture(0, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, HEAT_SIDE, HEAT_SIDE, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    float side = HEAT_SIDE * HEATMAP_PIXEL;
+    float x0 = width - HEATMAP_MARGIN - side, y0 = HEATMAP_MARGIN;
+    float x1 = x0 + side, y1 = y0 + side;
+    Vertex quad[6] = {
+        { x0, y0, 0.0f, 0.0f, { 255, 255, 255, 230 } },
+        { x1, y0, 1.0f, 0.0f, { 255, 255, 255, 230 } },
+        { x1, y1, 1.0f, 1.0f, { 255, 255, 255, 230 } },
+        { x0, y0, 0.0f, 0.0f, { 255, 255, 255, 230 } },
+        { x1, y1, 1.0f, 1.0f, { 255, 255, 255, 230 } },
+        { x0, y1, 0.0f, 1.0f, { 255, 255, 255, 230 } },
+    };
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl_state().viewport(0, 0, width, height);
+    gl_state().use_program(shader->ID);
+    shader->setInt("heat", 0);
+    shader->setVec2("outputSize", (float)width, (float)height);
+    gl_state().bind_vertex_array(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glDisable(GL_BLEND);
+}
@@ -0,0 +1,37 @@
+#ifndef HEATMAP_VIEW_HPP
+#define HEATMAP_VIEW_HPP
+#include <glad/glad.h>
+#include <chrono>
+
+#include "Shader.h"
+#include "memory_heat.hpp"
+
+#define HEATMAP_PIXEL 3                 // screen pixels per memory byte
+#define HEATMAP_MARGIN 8
+
+// shows a MemoryHeat image as a 64x64 texture in the top right corner of
+// the window, one row per 64 bytes with address 0 at the top left. Reuses
+// the HUD vertex shader, so it is one more small draw after the HUD.
+class HeatmapView {
+    public:
+        ~HeatmapView();
+        bool init(MemoryHeat *heat);
+        void toggle() { visible = !visible; }
+        void draw(int width, int height);  // into the bound framebuffer
+
+    private:
+        struct Vertex {
+            float x, y;
+            float u, v;
+            uint8_t color[4];
+        };
+
+        MemoryHeat *source{};
+        bool visible{true};
+        Shader *shader{};
+        unsigned int texture{}, vao{}, vbo{};
+        uint8_t pixels[HEAT_SIDE * HEAT_SIDE * 3]{};
+        std::chrono::steady_clock::time_point last_frame;
+};
+
+#endif
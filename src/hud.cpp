@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+
+#include "hud.hpp"
+#include "chip8.hpp"
+#include "gl_util.hpp"
+
+#define GLYPH_WIDTH 4
+#define GLYPH_HEIGHT 5
+#define ADVANCE ((GLYPH_WIDTH + 1) * HUD_PIXEL)
+#define LINE_HEIGHT ((GLYPH_HEIGHT + 2) * HUD_PIXEL)
+#define MARGIN 8
+#define PADDING 6
+
+#define COLOR_PANEL 0x000000B0
+#define COLOR_TEXT  0xFFFFFFFF
+#define COLOR_LABEL 0xA0A0A0FF
+#define COLOR_GOOD  0x40E040FF
+#define COLOR_SLOW  0xFF4040FF
+#define COLOR_LINE  0xFFFFFF60
+
+// the fontset has 0-F, these follow it in the atlas in the same format
+static const char extra_chars[] = "GHIJKLMNOPQRSTUVWXYZ .%/:-_";
+static const uint8_t extra_glyphs[] = {
+    0xF0, 0x80, 0xB0, 0x90, 0xF0, // G
+    0x90, 0x90, 0xF0, 0x90, 0x90, // H
+    0xE0, 0x40, 0x40, 0x40, 0xE0, // I
+    0x70, 0x20, 0x20, 0xA0, 0xE0, // J
+    0x90, 0xA0, 0xC0, 0xA0, 0x90, // K
+    0x80, 0x80, 0x80, 0x80, 0xF0, // L
+    0x90, 0xF0, 0xF0, 0x90, 0x90, // M
+    0x90, 0xD0, 0xB0, 0x90, 0x90, // N
+    0x60, 0x90, 0x90, 0x90, 0x60, // O
+    0xE0, 0x90, 0xE0, 0x80, 0x80, // P
+    0x60, 0x90, 0x90, 0xB0, 0x70, // Q
+    0xE0, 0x90, 0xE0, 0xA0, 0x90, // R
+    0x70, 0x80, 0x60, 0x10, 0xE0, // S
+    0xE0, 0x40, 0x40, 0x40, 0x40, // T
+    0x90, 0x90, 0x90, 0x90, 0x60, // U
+    0x90, 0x90, 0x90, 0x60, 0x60, // V
+    0x90, 0x90, 0xF0, 0xF0, 0x90, // W
+    0x90, 0x90, 0x60, 0x90, 0x90, // X
+    0xA0, 0xA0, 0x40, 0x40, 0x40, // Y
+    0xF0, 0x10, 0x60, 0x80, 0xF0, // Z
+    0x00, 0x00, 0x00, 0x00, 0x00, // space
+    0x00, 0x00, 0x00, 0x00, 0x40, // .
+    0x90, 0x10, 0x20, 0x40, 0x90, // %
+    0x10, 0x10, 0x20, 0x40, 0x80, // /
+    0x00, 0x40, 0x00, 0x40, 0x00, // :
+    0x00, 0x00, 0xF0, 0x00, 0x00, // -
+    0x00, 0x00, 0x00, 0x00, 0xF0, // _
+};
+#define EXTRA_GLYPHS ((int)sizeof(extra_chars) - 1)
+#define SOLID (16 + EXTRA_GLYPHS)       // fully lit cell for panels and bars
+#define GLYPHS (SOLID + 1)
+#define ATLAS_WIDTH (GLYPHS * GLYPH_WIDTH)
+
+static int glyph_index(char c){
+    c = std::toupper((unsigned char)c);
+    if(c >= '0' && c <= '9'){
+        return c - '0';
+    }
+    if(c >= 'A' && c <= 'F'){
+        return 10 + c - 'A';
+    }
+    for(int i = 0; i < EXTRA_GLYPHS; i++){
+        if(extra_chars[i] == c){
+            return 16 + i;
+        }
+    }
+    return glyph_index(' ');
+}
+
+Hud::~Hud(){
+    if(shader){
+        glDeleteProgram(shader->ID);
+        delete shader;
+    }
+    glDeleteTextures(1, &atlas);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+bool Hud::init(){
+    // one byte per atlas pixel, glyph rows top to bottom
+    uint8_t pixels[GLYPH_HEIGHT][ATLAS_WIDTH] = {};
+    for(int g = 0; g < GLYPHS; g++){
+        for(int row = 0; row < GLYPH_HEIGHT; row++){
+            uint8_t bits = 0xF0;
+            if(g < 16){
+                bits = Chip8::fontset[g * GLYPH_HEIGHT + row];
+            }
+            else if(g < SOLID){
+                bits = extra_glyphs[(g - 16) * GLYPH_HEIGHT + row];
+            }
+            for(int col = 0; col < GLYPH_WIDTH; col++){
+                pixels[row][g * GLYPH_WIDTH + col] = (bits & (0x80 >> col)) ? 255 : 0;
+            }
+        }
+    }
+    glGenTextures(1, &atlas);
+    gl_state().bind_texture(0, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, GLYPH_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    gl_state().bind_vertex_array(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glEnableVertexAttribArray(2);
+
+    shader = new Shader("hud.vert", "hud.frag");
+    last_frame = last_update = std::chrono::steady_clock::now();
+    // a program that failed to link still has an ID
+    int linked = 0;
+    glGetProgramiv(shader->ID, GL_LINK_STATUS, &linked);
+    return linked != 0;
+}
+
+void Hud::set_frame_stats(FrameStats *frame_stats){
+    stats = frame_stats;
+    timer.record_to(&stats->timing("gpu hud"));
+}
+
+void Hud::add_quad(float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t rgba){
+    Vertex corner[4] = {
+        { x,     y,     u0, v0, {} },
+        { x + w, y,     u1, v0, {} },
+        { x + w, y + h, u1, v1, {} },
+        { x,     y + h, u0, v1, {} },
+    };
+    for(Vertex &v : corner){
+        v.color[0] = rgba >> 24;
+        v.color[1] = rgba >> 16;
+        v.color[2] = rgba >> 8;
+        v.color[3] = rgba;
+    }
+    const int order[6] = { 0, 1, 2, 0, 2, 3 };
+    for(int i : order){
+        vertices.push_back(corner[i]);
+    }
+}
+
+void Hud::add_rect(float x, float y, float w, float h, uint32_t rgba){
+    // sample inside the solid cell so filtering never reaches a neighbour
+    float u = (SOLID * GLYPH_WIDTH + GLYPH_WIDTH / 2.0f) / ATLAS_WIDTH;
+    add_quad(x, y, w, h, u, 0.5f, u, 0.5f, rgba);
+}
+
+void Hud::add_glyph(float x, float y, int glyph, uint32_t rgba){
+    float u0 = (float)(glyph * GLYPH_WIDTH) / ATLAS_WIDTH;
+    float u1 = (float)(glyph * GLYPH_WIDTH + GLYPH_WIDTH) / ATLAS_WIDTH;
+    add_quad(x, y, GLYPH_WIDTH * HUD_PIXEL, GLYPH_HEIGHT * HUD_PIXEL, u0, 0.0f, u1, 1.0f, rgba);
+}
+
+float Hud::add_text(float x, float y, const std::string &text, uint32_t rgba){
+    for(char c : text){
+        if(c != ' '){
+            add_glyph(x, y, glyph_index(c), rgba);
+        }
+        x += ADVANCE;
+    }
+    return x;
+}
+
+void Hud::update_text(){
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - last_update).count();
+    last_update = now;
+    char line[64];
+    lines.clear();
+
+    unsigned long cycles = stats ? stats->cycles - last_cycles : 0;
+    unsigned long loops = stats ? stats->loops - last_loops : 0;
+    unsigned long idle = stats ? stats->idle_loops - last_idle : 0;
+    std::snprintf(line, sizeof(line), "IPS %.0f", cycles / seconds);
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "FPS %.0f", (frames - last_frames) / seconds);
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "DROPPED %lu", dropped);
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "IDLE %.1f%%", loops ? 100.0 * idle / loops : 0.0);
+    lines.push_back(line);
+    if(stats){
+        last_cycles = stats->cycles;
+        last_loops = stats->loops;
+        last_idle = stats->idle_loops;
+    }
+    last_frames = frames;
+
+    // average GPU time of every timed pass, names without prefix and extension
+    lines.push_back("GPU MS");
+    if(stats){
+        stats->for_each([&](const std::string &name, const RollingTiming &timing){
+            if(name.compare(0, 4, "gpu ") != 0 || !timing.count()){
+                return;
+            }
+            std::string pass = name.substr(4, name.find('.') == std::string::npos ? std::string::npos : name.find('.') - 4);
+            std::snprintf(line, sizeof(line), " %-16s %.3f", pass.c_str(), timing.average());
+            lines.push_back(line);
+        });
+    }
+    std::snprintf(line, sizeof(line), "HUD CPU %.3f MS", cpu_ms);
+    lines.push_back(line);
+}
+
+void Hud::draw(int width, int height){
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    float ms = std::chrono::duration<float, std::milli>(now - last_frame).count();
+    last_frame = now;
+    graph[graph_next] = ms;
+    graph_next = (graph_next + 1) % HUD_GRAPH_FRAMES;
+    frames++;
+    // timer jitter puts frames just over budget; only a missed vblank drops one
+    if(ms > HUD_DROP_MS){
+        dropped++;
+    }
+    timer.poll();
+    if(!visible){
+        return;
+    }
+    if(lines.empty() || now - last_update >= std::chrono::milliseconds(HUD_UPDATE_MS)){
+        update_text();
+    }
+
+    // panel behind four counter lines, the graph, then the pass timings
+    size_t columns = 0;
+    for(const std::string &line : lines){
+        columns = std::max(columns, line.size());
+    }
+    float graph_width = HUD_GRAPH_FRAMES * HUD_PIXEL;
+    float panel_width = std::max((float)columns * ADVANCE - HUD_PIXEL, graph_width) + 2 * PADDING;
+    float panel_height = lines.size() * LINE_HEIGHT + HUD_GRAPH_HEIGHT + LINE_HEIGHT + 2 * PADDING;
+    float x = MARGIN + PADDING, y = MARGIN + PADDING;
+    vertices.clear();
+    add_rect(MARGIN, MARGIN, panel_width, panel_height, COLOR_PANEL);
+    for(size_t i = 0; i < lines.size(); i++){
+        if(i == 4){
+            // frame times, oldest on the left, with a line at 60 Hz
+            float base = y + HUD_GRAPH_HEIGHT;
+            for(int f = 0; f < HUD_GRAPH_FRAMES; f++){
+                float value = graph[(graph_next + f) % HUD_GRAPH_FRAMES];
+                float bar = std::min(value, HUD_GRAPH_RANGE_MS) / HUD_GRAPH_RANGE_MS * HUD_GRAPH_HEIGHT;
+                add_rect(x + f * HUD_PIXEL, base - bar, HUD_PIXEL, bar, value > HUD_DROP_MS ? COLOR_SLOW : COLOR_GOOD);
+            }
+            float budget = HUD_FRAME_MS / HUD_GRAPH_RANGE_MS * HUD_GRAPH_HEIGHT;
+            add_rect(x, base - budget, graph_width, 1, COLOR_LINE);
+            y += HUD_GRAPH_HEIGHT + LINE_HEIGHT;
+        }
+        const std::string &line = lines[i];
+        size_t split = line.find(' ', 1);
+        float after = add_text(x, y, line.substr(0, split), COLOR_LABEL);
+        if(split != std::string::npos){
+            add_text(after, y, line.substr(split), COLOR_TEXT);
+        }
+        y += LINE_HEIGHT;
+    }
+    cpu_ms += 0.05 * (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count() - cpu_ms);
+
+    timer.begin();
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl_state().viewport(0, 0, width, height);
+    gl_state().use_program(shader->ID);
+    gl_state().bind_texture(0, atlas);
+    shader->setInt("atlas", 0);
+    shader->setVec2("outputSize", (float)width, (float)height);
+    gl_state().bind_vertex_array(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+    glDisable(GL_BLEND);
+    timer.end();
+}
@@ -0,0 +1,65 @@
+#ifndef HUD_HPP
+#define HUD_HPP
+#include <glad/glad.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+#include "frame_stats.hpp"
+#include "gpu_timer.hpp"
+
+#define HUD_PIXEL 2                     // screen pixels per font pixel
+#define HUD_GRAPH_FRAMES 120            // frame times in the graph
+#define HUD_GRAPH_HEIGHT 40             // screen pixels for HUD_GRAPH_RANGE_MS
+#define HUD_GRAPH_RANGE_MS 33.3f
+#define HUD_FRAME_MS (1000.0f / 60.0f)  // budget at 60 Hz, the line in the graph
+#define HUD_DROP_MS (1.5f * HUD_FRAME_MS) // longer frames missed a vblank and count as dropped
+#define HUD_UPDATE_MS 250               // text refresh, numbers stay readable
+
+// performance overlay on top of the frame: emulated instructions per second,
+// FPS, a frame time graph, dropped frames, the share of loop iterations that
+// ran no instruction, and GPU time per pass. Glyphs come from an atlas built
+// from the chip 8 fontset plus the letters it lacks, and the whole overlay is
+// one vertex buffer drawn with a single call. Frame times are tracked while
+// hidden so the graph is full when it is shown.
+class Hud {
+    public:
+        ~Hud();
+        bool init();
+        void set_frame_stats(FrameStats *frame_stats);
+        void toggle() { visible = !visible; }
+        void show() { visible = true; }
+        void draw(int width, int height);  // into the bound framebuffer
+
+    private:
+        struct Vertex {
+            float x, y;                 // pixels
+            float u, v;
+            uint8_t color[4];
+        };
+
+        void update_text();
+        void add_quad(float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t rgba);
+        void add_rect(float x, float y, float w, float h, uint32_t rgba);
+        void add_glyph(float x, float y, int glyph, uint32_t rgba);
+        float add_text(float x, float y, const std::string &text, uint32_t rgba);
+
+        bool visible{};
+        Shader *shader{};
+        unsigned int atlas{}, vao{}, vbo{};
+        GpuTimer timer;
+        FrameStats *stats{};
+        std::vector<Vertex> vertices;
+        std::vector<std::string> lines;
+        double cpu_ms{};                // building the vertices, smoothed
+
+        // frame times, oldest first from graph_next
+        float graph[HUD_GRAPH_FRAMES]{};
+        int graph_next{};
+        std::chrono::steady_clock::time_point last_frame, last_update;
+        unsigned long frames{}, dropped{};
+        unsigned long last_cycles{}, last_loops{}, last_idle{}, last_frames{};
+};
+
+#endif
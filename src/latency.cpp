@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "latency.hpp"
+
+// an event that has not changed the screen after this long is dropped so it
+// is not matched with an unrelated draw later on
+#define LATENCY_TIMEOUT std::chrono::seconds(1)
+
+static float ms_between(LatencyTracker::clock::time_point from, LatencyTracker::clock::time_point to){
+    return std::chrono::duration<float, std::chrono::milliseconds::period>(to - from).count();
+}
+
+// nearest-rank percentile of an already sorted list
+static float percentile(const std::vector<float> &sorted, float p){
+    if(sorted.empty()){
+        return 0.0f;
+    }
+    size_t rank = (size_t)(p / 100.0f * (sorted.size() - 1) + 0.5f);
+    return sorted[rank];
+}
+
+void LatencyTracker::input_event(clock::time_point when){
+    if(pending){
+        if(when - polled < LATENCY_TIMEOUT){
+            // until the ROM reads the keys it will only see the newest state,
+            // so time from that; after the read keep the event being drawn
+            if(!read){
+                polled = when;
+            }
+            coalesced++;
+            return;
+        }
+        dropped++;
+    }
+    pending = true;
+    read = false;
+    drawn = false;
+    polled = when;
+}
+
+void LatencyTracker::key_read(){
+    if(pending && !read){
+        read = true;
+        written = clock::now();
+    }
+}
+
+void LatencyTracker::screen_changed(){
+    // a change before the ROM looked at the keys is not caused by them
+    if(pending && read && !drawn){
+        drawn = true;
+        draw = clock::now();
+    }
+}
+
+void LatencyTracker::frame_presented(){
+    if(!pending){
+        return;
+    }
+    clock::time_point now = clock::now();
+    if(!drawn){
+        if(now - polled >= LATENCY_TIMEOUT){
+            pending = false;
+            dropped++;
+        }
+        return;
+    }
+    to_key.push_back(ms_between(polled, written));
+    to_draw.push_back(ms_between(written, draw));
+    to_present.push_back(ms_between(draw, now));
+    total.push_back(ms_between(polled, now));
+    pending = false;
+}
+
+void LatencyTracker::report(std::ostream &out) const{
+    out << "input-to-photon latency: " << total.size() << " events, "
+        << coalesced << " coalesced, " << dropped << " without visible effect\n";
+    if(total.empty()){
+        return;
+    }
+
+    // percentiles for each stage of the pipeline
+    struct Stage { const char *name; std::vector<float> values; };
+    Stage stages[] = {
+        { "input->key",  to_key },
+        { "key->draw",   to_draw },
+        { "draw->swap",  to_present },
+        { "total",       total },
+    };
+    out << std::fixed << std::setprecision(2);
+    for(Stage &stage : stages){
+        std::sort(stage.values.begin(), stage.values.end());
+        out << "  " << std::setw(12) << std::left << stage.name << std::right
+            << " p50 " << std::setw(8) << percentile(stage.values, 50.0f) << " ms"
+            << "  p95 " << std::setw(8) << percentile(stage.values, 95.0f) << " ms"
+            << "  p99 " << std::setw(8) << percentile(stage.values, 99.0f) << " ms\n";
+    }
+
+    // histogram of total latency with power of two buckets
+    const float bounds[] = { 1, 2, 4, 8, 16, 33, 66, 133, 266 };
+    const int buckets = sizeof(bounds) / sizeof(bounds[0]) + 1;
+    unsigned long counts[buckets] = {};
+    for(float v : total){
+        int b = 0;
+        while(b < buckets - 1 && v >= bounds[b]){
+            b++;
+        }
+        counts[b]++;
+    }
+    out << std::setprecision(0);
+    for(int b = 0; b < buckets; b++){
+        out << "  ";
+        if(b == 0){
+            out << "     < " << std::setw(4) << bounds[0];
+        }
+        else if(b == buckets - 1){
+            out << "    >= " << std::setw(4) << bounds[b - 1];
+        }
+        else{
+            out << std::setw(4) << bounds[b - 1] << " - " << std::setw(4) << bounds[b];
+        }
+        int bar = (int)(40 * counts[b] / total.size());
+        out << " ms " << std::setw(6) << counts[b] << " " << std::string(bar, '#') << "\n";
+    }
+}
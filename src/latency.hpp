@@ -0,0 +1,39 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// measures input-to-photon latency: a key event seen by processInput is
+// tagged with a timestamp, then followed through the first instruction that
+// reads Chip8::key after it, the first screen change after that read and the
+// glfwSwapBuffers that shows it.
+class LatencyTracker {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        void input_event(clock::time_point when);      // key state changed
+        void key_read();                                // EX9E, EXA1 or FX0A executed
+        void screen_changed();                          // DXYN or 00E0 executed
+        void frame_presented();                         // glfwSwapBuffers returned
+        void report(std::ostream &out) const;           // histogram and percentiles
+
+    private:
+        bool pending{};             // an event is waiting to be presented
+        bool read{};                // the ROM has read the keys since the event
+        bool drawn{};               // the screen changed since the read
+        clock::time_point polled;   // when processInput saw the event
+        clock::time_point written;  // when the ROM first read the keys
+        clock::time_point draw;     // first screen change after the read
+
+        unsigned long coalesced{};  // events that arrived while one was in flight
+        unsigned long dropped{};    // events with no visible effect before timeout
+
+        // per event durations in milliseconds
+        std::vector<float> to_key;      // input to key read
+        std::vector<float> to_draw;     // key read to screen change
+        std::vector<float> to_present;  // screen change to swap
+        std::vector<float> total;       // input to swap
+};
+
+#endif
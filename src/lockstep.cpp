@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "chip8.hpp"
+#include "chip8_state.hpp"
+#include "memory_heat.hpp"
+#include "opcode_profile.hpp"
+#include "rom_gen.hpp"
+
+// runs two execution engines side by side on the same ROM and key presses
+// and compares their full states every interval instructions. On a mismatch
+// both restart from the last matching state and bisect to the first
+// instruction after which they differ, then print both states:
+//   chip8-lockstep [--engines a,b] [--cycles n] [--interval n] [--key-seed n] [--generated] [<rom>...]
+// Without ROM files it checks the generated stress ROMs.
+#define LOCKSTEP_CYCLES 200000
+#define LOCKSTEP_INTERVAL 1000
+#define LOCKSTEP_KEY_PERIOD 1000        // instructions the same keys are held
+
+// an engine runs exactly n instructions from whatever state chip8 is in
+struct Engine {
+    const char *name;
+    void (*run)(Chip8 &chip8, unsigned long n);
+};
+
+static void run_interpreter(Chip8 &chip8, unsigned long n)
+{
+    for (unsigned long i = 0; i < n; i++)
+        chip8.cycle();
+}
+
+static void run_profiled(Chip8 &chip8, unsigned long n)
+{
+    static OpcodeProfile profile;
+    for (unsigned long i = 0; i < n; i++)
+        chip8.step(profile);
+}
+
+static void run_heatmap(Chip8 &chip8, unsigned long n)
+{
+    static OpcodeProfile profile;
+    static MemoryHeat heat;
+    ProfilePair<OpcodeProfile, MemoryHeat> both{profile, heat};
+    for (unsigned long i = 0; i < n; i++)
+        chip8.step(both);
+}
+
+// the reference first; faster paths join this table as they are added
+static const Engine engines[] = {
+    { "interpreter", run_interpreter },
+    { "profiled", run_profiled },
+    { "heatmap", run_heatmap },
+};
+
+struct Run {
+    const Engine *a, *b;
+    unsigned long cycles{LOCKSTEP_CYCLES};
+    unsigned long interval{LOCKSTEP_INTERVAL};
+    uint32_t keySeed{1};                // 0 holds no keys
+};
+
+static const Engine* find_engine(const std::string &name)
+{
+    for (const Engine &engine : engines)
+        if (name == engine.name)
+            return &engine;
+    return nullptr;
+}
+
+// the keys held during a period, the same for both engines
+static uint16_t key_mask(uint32_t seed, unsigned long period)
+{
+    if (!seed)
+        return 0;
+    uint32_t x = seed * 0x9E3779B9u ^ (uint32_t)period * 0x85EBCA6Bu;
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    // mostly one key or none, like a player
+    return (x & 3) ? 0 : 1u << ((x >> 8) & 0xF);
+}
+
+// n instructions starting at instruction number from, changing keys on
+// period boundaries
+static void advance(const Run &run, const Engine &engine, Chip8 &chip8, unsigned long from, unsigned long n)
+{
+    while (n)
+    {
+        unsigned long period = from / LOCKSTEP_KEY_PERIOD;
+        unsigned long chunk = std::min(n, (period + 1) * LOCKSTEP_KEY_PERIOD - from);
+        uint16_t mask = key_mask(run.keySeed, period);
+        for (int key = 0; key < 16; key++)
+            chip8.key[key] = (mask >> key) & 1;
+        engine.run(chip8, chunk);
+        from += chunk;
+        n -= chunk;
+    }
+}
+
+// true when the hash chip8 keeps up to date incrementally matches its state;
+// a stale one is reported on its own, apart from a difference between engines
+static bool hash_current(const Engine &engine, const Chip8 &chip8, const Chip8State &state, const std::string &name, unsigned long at)
+{
+    if (chip8.state_hash() == state_hash(state))
+        return true;
+    std::cout << name << ": " << engine.name << " incremental state hash " << std::hex << chip8.state_hash()
+              << " differs from the hash of its state " << state_hash(state) << std::dec
+              << " after instruction " << at << "\n";
+    print_state(std::cout, state);
+    return false;
+}
+
+// true when both engines agree over the whole run
+static bool check(const Run &run, const std::string &name, const std::vector<uint8_t> &rom)
+{
+    Chip8 *a = new Chip8();
+    Chip8 *b = new Chip8();
+    a->seed(1);
+    a->load(rom.data(), rom.size());
+    Chip8State good = a->state();
+    b->restore(good);
+    unsigned long at = 0;
+    bool same = true;
+    while (at < run.cycles)
+    {
+        unsigned long n = std::min(run.interval, run.cycles - at);
+        advance(run, *run.a, *a, at, n);
+        advance(run, *run.b, *b, at, n);
+        Chip8State stateA = a->state(), stateB = b->state();
+        if (!hash_current(*run.a, *a, stateA, name, at + n) || !hash_current(*run.b, *b, stateB, name, at + n))
+        {
+            same = false;
+            break;
+        }
+        if (same_state(stateA, stateB))
+        {
+            good = stateA;
+            at += n;
+            continue;
+        }
+
+        // they match after lo instructions from good and differ after hi
+        unsigned long lo = 0, hi = n;
+        while (hi - lo > 1)
+        {
+            unsigned long mid = (lo + hi) / 2;
+            a->restore(good);
+            b->restore(good);
+            advance(run, *run.a, *a, at, mid);
+            advance(run, *run.b, *b, at, mid);
+            if (same_state(a->state(), b->state()))
+                lo = mid;
+            else
+                hi = mid;
+        }
+        a->restore(good);
+        advance(run, *run.a, *a, at, lo);
+        Chip8State before = a->state();
+        b->restore(before);
+        advance(run, *run.a, *a, at + lo, 1);
+        advance(run, *run.b, *b, at + lo, 1);
+        Chip8State afterA = a->state(), afterB = b->state();
+
+        std::cout << name << ": " << run.a->name << " and " << run.b->name << " differ after instruction "
+                  << at + lo + 1 << "\nbefore it, in both:\n";
+        print_state(std::cout, before);
+        std::cout << run.a->name << " after:\n";
+        print_state(std::cout, afterA);
+        std::cout << run.b->name << " after:\n";
+        print_state(std::cout, afterB);
+        std::cout << "differences:\n";
+        print_differences(std::cout, afterA, afterB, run.a->name, run.b->name);
+        same = false;
+        break;
+    }
+    delete a;
+    delete b;
+    if (same)
+        std::cout << name << ": " << run.cycles << " instructions match\n";
+    return same;
+}
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [options] [<rom>...]\n"
+              << "  --engines <a,b>     engines to compare (default interpreter,profiled), from:";
+    for (const Engine &engine : engines)
+        std::cerr << " " << engine.name;
+    std::cerr << "\n"
+              << "  --cycles <n>        instructions per ROM (default " << LOCKSTEP_CYCLES << ")\n"
+              << "  --interval <n>      instructions between state comparisons (default " << LOCKSTEP_INTERVAL << ")\n"
+              << "  --key-seed <n>      seed of the key presses, 0 for none (default 1)\n"
+              << "  --generated         also check the generated stress ROMs, the default without ROM files\n";
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+    Run run;
+    run.a = &engines[0];
+    run.b = &engines[1];
+    bool generated = false;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--engines") == 0 && hasValue)
+        {
+            std::string names = argv[++i];
+            size_t comma = names.find(',');
+            run.a = find_engine(names.substr(0, comma));
+            run.b = comma == std::string::npos ? nullptr : find_engine(names.substr(comma + 1));
+            if (!run.a || !run.b)
+                usage(argv[0]);
+        }
+        else if (std::strcmp(argv[i], "--cycles") == 0 && hasValue)
+            run.cycles = std::strtoul(argv[++i], nullptr, 0);
+        else if (std::strcmp(argv[i], "--interval") == 0 && hasValue)
+            run.interval = std::max(1ul, std::strtoul(argv[++i], nullptr, 0));
+        else if (std::strcmp(argv[i], "--key-seed") == 0 && hasValue)
+            run.keySeed = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        else if (std::strcmp(argv[i], "--generated") == 0)
+            generated = true;
+        else if (argv[i][0] == '-')
+            usage(argv[0]);
+        else
+            paths.push_back(argv[i]);
+    }
+
+    int failures = 0;
+    for (const char *path : paths)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "Cannot read " << path << "\n";
+            return EXIT_FAILURE;
+        }
+        std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        failures += !check(run, path, rom);
+    }
+    if (generated || paths.empty())
+    {
+        for (const char *const *kind = rom_kinds; *kind; kind++)
+        {
+            for (uint32_t seed = 1; seed <= 2; seed++)
+            {
+                RomSpec spec;
+                spec.kind = *kind;
+                spec.seed = seed;
+                GeneratedRom rom;
+                if (!generate_rom(spec, rom))
+                    return EXIT_FAILURE;
+                failures += !check(run, spec.kind + " seed " + std::to_string(seed), rom.rom);
+            }
+        }
+    }
+    if (failures)
+        std::cout << failures << " ROMs differ\n";
+    return failures ? EXIT_FAILURE : 0;
+}
@@ -1,121 +1,243 @@
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
-// OpenGL math libraries
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
 #include <chrono>
+#include <cstring>
+#include <ctime>
 #include <iostream>
 
 #include "chip8.hpp"
-#include "Shader.h"
-#include "graphics.hpp"
-
-
-void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void processInput(GLFWwindow *window, Chip8 *chip8);
+#include "frame_stats.hpp"
+#include "latency.hpp"
+#include "memory_heat.hpp"
+#include "metrics.hpp"
+#include "movie.hpp"
+#include "opcode_profile.hpp"
+#include "options.hpp"
+#include "renderer.hpp"
+#include "shader_source.hpp"
+#include "startup_timer.hpp"
+#include "trace.hpp"
+
+// display refresh the skipped frame count is measured against
+#define REFRESH_MS (1000.0 / 60.0)
 
 int main(int argc, char** argv)
 {
-	if (argc != 3)
-	{
-		std::cerr << "Usage: " << argv[0] << " <Cycle Dela> <ROM>\n";
-		std::exit(EXIT_FAILURE);
-	}
+    StartupTimer startup;
 
-    
+    Options options;
+    parse_options(argc, argv, options);
 
-	// int videoScale = std::stoi(argv[1]);
-	int cycleDelay = std::stoi(argv[1]);
-	char const* romFilename = argv[2];
-	int videoScale = 30;
-    
-    // create window
-    GLFWwindow* window = setup_window(30);
-
-	// build and compile our shader program
-    // ------------------------------------
-    Shader ourShader("shaders/shader.vert", "shaders/shader.frag"); // you can name your shader files however you like
+    // timeline of the loop, written on exit or SIGUSR1
+    if (options.trace)
+    {
+        trace_start(options.trace);
+        trace_thread_name("main");
+    }
 
-    // create VAO for rendering
-    unsigned int VAO = make_VAO();
+    LatencyTracker latency;
+    LatencyTracker *latencyTracker = options.latency ? &latency : nullptr;
 
-    unsigned int modelLoc = glGetUniformLocation(ourShader.ID, "model");
-    unsigned int colorLoc = glGetUniformLocation(ourShader.ID, "color");
-    glm::vec3 color;
+    // built-in shaders unless a directory on disk is given
+    shader_source_set_directory(options.shader_dir);
 
-    glfwSwapInterval(0);
+    // create the window, terminal or nothing at all
+    Renderer *renderer = make_renderer(options.renderer);
+    if (!renderer)
+    {
+        std::cerr << "Unknown renderer: " << options.renderer << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if (!renderer->init(options, startup))
+    {
+        delete renderer;
+        std::exit(EXIT_FAILURE);
+    }
 
     // load chip 8
     Chip8 *chip8 = new Chip8();
-	chip8->loadROM(romFilename);
+	chip8->loadROM(options.rom);
+    chip8->draw_flag = true;
+
+    // with the seed and every key change in the input movie the run replays exactly
+    uint32_t seed = options.seed ? options.seed : (uint32_t)time(NULL);
+    chip8->seed(seed);
+    MovieWriter *movie = nullptr;
+    if (options.record_input)
+    {
+        uint64_t romHash = 0;
+        movie = new MovieWriter();
+        if (!rom_file_hash(options.rom, romHash) || !movie->open(options.record_input, romHash, seed))
+        {
+            std::cerr << "Cannot record input to " << options.record_input << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    startup.mark("ROM load");
+
+    // instrumented dispatch only when asked, cycle() stays uninstrumented
+    OpcodeProfile *profile = options.opcode_stats ? new OpcodeProfile() : nullptr;
+    MemoryHeat *heat = options.heatmap ? new MemoryHeat() : nullptr;
+    renderer->set_memory_heat(heat);
+
+    // loop counters and GPU timings always go to frameStats for the HUD,
+    // CPU timings of each part of the frame only with --frame-stats
+    FrameStats frameStats;
+    FrameStats *stats = options.frame_stats ? &frameStats : nullptr;
+    RollingTiming *inputTime = stats ? &stats->timing("cpu input") : nullptr;
+    RollingTiming *emulateTime = stats ? &stats->timing("cpu emulate") : nullptr;
+    RollingTiming *uploadTime = stats ? &stats->timing("cpu upload") : nullptr;
+    RollingTiming *drawTime = stats ? &stats->timing("cpu draw") : nullptr;
+    RollingTiming *presentTime = stats ? &stats->timing("cpu present") : nullptr;
+    renderer->set_frame_stats(&frameStats);
+
+    // counters for fleet monitoring, exported by a background thread
+    MetricsRegistry &registry = metrics();
+    Counter &instructions = registry.counter("chip8_instructions_total", "Instructions executed");
+    Counter &presented = registry.counter("chip8_frames_presented_total", "Frames presented");
+    Counter &skipped = registry.counter("chip8_frames_skipped_total", "60 Hz refreshes that passed without a new frame");
+    Counter &keyEvents = registry.counter("chip8_key_events_total", "Key presses and releases seen by the emulator");
+    Counter &invalidOpcodes = registry.counter("chip8_invalid_opcodes_total", "Instructions that decoded to no operation");
+    Histogram &frameTime = registry.histogram("chip8_frame_time_ms", "Time between presented frames in milliseconds",
+                                              { 1, 2, 4, 8, 16.7, 33.3, 66.7, 133.3, 266.7 });
+    if (options.metrics && !registry.start(options.metrics, options.metrics_interval))
+    {
+        std::cerr << "Cannot export metrics to " << options.metrics << "\n";
+        std::exit(EXIT_FAILURE);
+    }
 
     // render loop
     // -----------
-    auto lastCycleTime = std::chrono::high_resolution_clock::now();
-    int lessthan = 0;
-    while (!glfwWindowShouldClose(window))
+    bool startupTimes = options.startup_times;
+    long frames = 0;
+    unsigned long keyReads = 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    auto lastCycleTime = startTime;
+    auto lastPresentTime = startTime;
+    while (!renderer->should_close())
     {
         // input
         // -----
-        processInput(window, chip8);
-
-        ourShader.use();
-        glBindVertexArray(VAO);
+        {
+            TRACE_SCOPE("input");
+            ScopedTiming timing(inputTime);
+            uint8_t keys[16];
+            std::memcpy(keys, chip8->key, sizeof(keys));
+            renderer->process_input(*chip8, latencyTracker);
+            for (int i = 0; i < 16; i++)
+                if (keys[i] != chip8->key[i])
+                    keyEvents.add();
+            if (movie)
+                movie->keys(frameStats.cycles, chip8->key);
+        }
 
-        GLfloat color[3]; 
-        
         auto currentTime = std::chrono::high_resolution_clock::now();
 		float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
         
-		if (dt > cycleDelay)
+		if (dt > options.cycle_delay)
 		{
-            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-            
             lastCycleTime = currentTime;
             
 			// chip 8 cycle
-            chip8->cycle();
-            for(int y = 0; y < VIDEO_HEIGHT; y++){
-                for(int x = 0; x < VIDEO_WIDTH; x++){
-                    if(chip8->screen[(y * VIDEO_WIDTH) + x] == 0){
-                        color[0] = 0.0f;
-                        color[1] = 0.0f;
-                        color[2] = 0.0f;
-                        
-                    }
-                    else{
-                        color[0] = 1.0f;
-                        color[1] = 1.0f;
-                        color[2] = 1.0f;
-                        
-                    }
-                    float x_coord = x / (64.0f);
-                    float y_coord = -y / (32.0f);
-
-                    glm::mat4 model = glm::mat4(1.0f);
-                    model = glm::translate(model, glm::vec3(x_coord, y_coord, 0.0f));
-                    model = glm::translate(model, glm::vec3(-.5f, .5f, 0.0f));
-                    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-                    glUniform3fv(colorLoc, 1, color);
-                    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-                }
+            TRACE_SCOPE("emulate");
+            ScopedTiming timing(emulateTime);
+            if (profile && heat)
+            {
+                ProfilePair<OpcodeProfile, MemoryHeat> both{*profile, *heat};
+                chip8->step(both);
+            }
+            else if (profile)
+                chip8->step(*profile);
+            else if (heat)
+                chip8->step(*heat);
+            else
+                chip8->cycle();
+            frameStats.cycles++;
+            if (latencyTracker && chip8->key_reads != keyReads)
+            {
+                keyReads = chip8->key_reads;
+                latencyTracker->key_read();
             }
-		} 
+            if (movie && options.checkpoint_interval && frameStats.cycles % options.checkpoint_interval == 0)
+                movie->checkpoint(frameStats.cycles, chip8->state_hash());
+		}
+        else
+            frameStats.idle_loops++;
+        frameStats.loops++;
+
+        // hand the screen over only when it changed
+        if (chip8->draw_flag)
+        {
+            chip8->draw_flag = false;
+            if (latencyTracker)
+                latencyTracker->screen_changed();
+            TRACE_SCOPE("upload");
+            ScopedTiming timing(uploadTime);
+            renderer->upload(*chip8);
+        }
+
+        {
+            TRACE_SCOPE("draw");
+            ScopedTiming timing(drawTime);
+            renderer->draw();
+        }
+        {
+            TRACE_SCOPE("present");
+            ScopedTiming timing(presentTime);
+            renderer->present();
+        }
+        // refreshes are counted on a fixed 60 Hz grid from the start
+        auto presentedAt = std::chrono::high_resolution_clock::now();
+        double frameMs = std::chrono::duration<double, std::milli>(presentedAt - lastPresentTime).count();
+        long refreshes = (long)(std::chrono::duration<double, std::milli>(presentedAt - startTime).count() / REFRESH_MS)
+                       - (long)(std::chrono::duration<double, std::milli>(lastPresentTime - startTime).count() / REFRESH_MS);
+        lastPresentTime = presentedAt;
+        presented.add();
+        frameTime.observe(frameMs);
+        if (refreshes > 1)
+            skipped.add(refreshes - 1);
+        instructions.set(frameStats.cycles);
+        invalidOpcodes.set(chip8->invalid_opcodes);
+
+        if (stats && stats->log_due())
+            stats->log(std::cout);
+        trace_poll();
+        if (latencyTracker)
+            latencyTracker->frame_presented();
+        if (startupTimes)
+        {
+            startup.mark("first frame");
+            startup.report(std::cout);
+            startupTimes = false;
+        }
+        if (options.frames && ++frames >= options.frames)
+            break;
+    }
 
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    trace_stop();
+    registry.stop();
+    if (latencyTracker)
+        latencyTracker->report(std::cout);
+    renderer->report(std::cout);
+    if (movie)
+    {
+        movie->close(frameStats.cycles);
+        movie->report(std::cout);
+    }
+    if (profile)
+        profile->report(std::cout);
+    if (stats)
+        stats->report(std::cout);
+    if (options.renderer == "null")
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        std::cout << "emulation: " << frameStats.cycles << " cycles in " << seconds << " s, "
+                  << frameStats.cycles / seconds << " cycles/s\n";
     }
 
-    // glfw: terminate, clearing all previously allocated GLFW resources.
-    // ------------------------------------------------------------------
-    glfwTerminate();
+    delete renderer;
+    delete chip8;
+    delete profile;
+    delete heat;
+    delete movie;
     return 0;
 
 }
-
-
@@ -0,0 +1,24 @@
+#include <algorithm>
+#include <cmath>
+
+#include "memory_heat.hpp"
+
+// brightness of a count, log scaled so one access still shows
+static float heat(uint32_t count){
+    return count ? std::min(1.0f, 0.25f + std::log2((float)count) / 10.0f) : 0.0f;
+}
+
+void MemoryHeat::render(uint8_t *rgb, float frame_time){
+    float keep = std::pow(HEAT_DECAY, frame_time * 60.0f);
+    const uint32_t *channels[3] = { writes, executes, reads };
+    for(int i = 0; i < 4096; i++){
+        for(int c = 0; c < 3; c++){
+            float &g = glow[i * 3 + c];
+            g = std::max(g * keep, heat(channels[c][i]));
+            rgb[i * 3 + c] = (uint8_t)(g * 255.0f);
+        }
+    }
+    std::fill(reads, reads + 4096, 0);
+    std::fill(writes, writes + 4096, 0);
+    std::fill(executes, executes + 4096, 0);
+}
@@ -0,0 +1,43 @@
+#ifndef MEMORY_HEAT_HPP
+#define MEMORY_HEAT_HPP
+#include <cstdint>
+
+#define HEAT_SIDE 64                    // 4096 bytes as a 64x64 image, 64 bytes per row
+#define HEAT_DECAY 0.9f                 // brightness kept per 60 Hz frame
+
+// Chip8::step() policy counting reads, writes and executes of every memory
+// byte. Counts come from the decoded instruction before it runs: the fetch
+// executes pc and pc + 1, FX55 and FX33 write at I, FX65 and DXYN read at I.
+// render() turns the counts since its last call into a decaying RGB image,
+// red for writes, green for executes and blue for reads.
+class MemoryHeat {
+    public:
+        void instruction(uint16_t pc, uint16_t opcode, uint16_t index){
+            executes[pc & 0xFFF]++;
+            executes[(pc + 1) & 0xFFF]++;
+            int x = (opcode >> 8) & 0xF;
+            switch(opcode & 0xF0FF){
+                case 0xF055: count(writes, index, x + 1); return;
+                case 0xF065: count(reads, index, x + 1); return;
+                case 0xF033: count(writes, index, 3); return;
+            }
+            if((opcode & 0xF000) == 0xD000){
+                count(reads, index, opcode & 0xF);
+            }
+        }
+        void render(uint8_t *rgb, float frame_time);    // HEAT_SIDE^2 RGB pixels
+
+    private:
+        static void count(uint32_t *counts, uint16_t start, int n){
+            for(int i = 0; i < n; i++){
+                counts[(start + i) & 0xFFF]++;
+            }
+        }
+
+        uint32_t reads[4096]{};
+        uint32_t writes[4096]{};
+        uint32_t executes[4096]{};
+        float glow[4096 * 3]{};
+};
+
+#endif
@@ -0,0 +1,247 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "metrics.hpp"
+
+MetricsRegistry &metrics(){
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void Histogram::observe(double value){
+    size_t bucket = 0;
+    while(bucket < bounds.size() && value > bounds[bucket]){
+        bucket++;
+    }
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_millionths.fetch_add((uint64_t)(value * 1e6), std::memory_order_relaxed);
+}
+
+MetricsRegistry::~MetricsRegistry(){
+    stop();
+}
+
+Counter& MetricsRegistry::counter(const std::string &name, const std::string &help){
+    std::lock_guard<std::mutex> guard(lock);
+    for(Entry &entry : entries){
+        if(entry.name == name){
+            return entry.counter;
+        }
+    }
+    entries.emplace_back();
+    entries.back().name = name;
+    entries.back().help = help;
+    return entries.back().counter;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string &name, const std::string &help, const std::vector<double> &bounds){
+    std::lock_guard<std::mutex> guard(lock);
+    for(Entry &entry : entries){
+        if(entry.name == name){
+            return entry.histogram;
+        }
+    }
+    entries.emplace_back();
+    Entry &entry = entries.back();
+    entry.name = name;
+    entry.help = help;
+    entry.is_histogram = true;
+    entry.histogram.bounds.assign(bounds.begin(), bounds.begin() + std::min(bounds.size(), (size_t)METRICS_HISTOGRAM_BUCKETS));
+    return entry.histogram;
+}
+
+void MetricsRegistry::write_prometheus(std::ostream &out) const{
+    std::lock_guard<std::mutex> guard(lock);
+    for(const Entry &entry : entries){
+        out << "# HELP " << entry.name << " " << entry.help << "\n";
+        if(!entry.is_histogram){
+            out << "# TYPE " << entry.name << " counter\n"
+                << entry.name << " " << entry.counter.get() << "\n";
+            continue;
+        }
+        const Histogram &h = entry.histogram;
+        out << "# TYPE " << entry.name << " histogram\n";
+        uint64_t cumulative = 0;
+        for(size_t i = 0; i <= h.bounds.size(); i++){
+            cumulative += h.counts[i].load(std::memory_order_relaxed);
+            out << entry.name << "_bucket{le=\"";
+            if(i < h.bounds.size()){
+                out << h.bounds[i];
+            }
+            else{
+                out << "+Inf";
+            }
+            out << "\"} " << cumulative << "\n";
+        }
+        out << entry.name << "_sum " << h.sum_millionths.load(std::memory_order_relaxed) / 1e6 << "\n"
+            << entry.name << "_count " << cumulative << "\n";
+    }
+}
+
+void MetricsRegistry::write_json(std::ostream &out) const{
+    std::lock_guard<std::mutex> guard(lock);
+    out << "{";
+    bool first = true;
+    for(const Entry &entry : entries){
+        out << (first ? "\n" : ",\n") << "  \"" << entry.name << "\": ";
+        first = false;
+        if(!entry.is_histogram){
+            out << entry.counter.get();
+            continue;
+        }
+        const Histogram &h = entry.histogram;
+        uint64_t count = 0;
+        out << "{\"buckets\": {";
+        for(size_t i = 0; i <= h.bounds.size(); i++){
+            uint64_t n = h.counts[i].load(std::memory_order_relaxed);
+            count += n;
+            out << (i ? ", \"" : "\"");
+            if(i < h.bounds.size()){
+                out << h.bounds[i];
+            }
+            else{
+                out << "+Inf";
+            }
+            out << "\": " << n;
+        }
+        out << "}, \"sum\": " << h.sum_millionths.load(std::memory_order_relaxed) / 1e6 << ", \"count\": " << count << "}";
+    }
+    out << "\n}\n";
+}
+
+bool MetricsRegistry::start(const std::string &target, int interval_seconds){
+    socket_target = target.compare(0, 5, "unix:") == 0;
+    path = socket_target ? target.substr(5) : target;
+    json = !socket_target && path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    interval = interval_seconds > 0 ? interval_seconds : METRICS_DEFAULT_INTERVAL;
+
+    if(socket_target){
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if(path.size() >= sizeof(address.sun_path)){
+            return false;
+        }
+        std::strcpy(address.sun_path, path.c_str());
+        listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        // a socket left behind by an earlier run would make bind fail
+        unlink(path.c_str());
+        if(listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4) != 0){
+            return false;
+        }
+    }
+    if(pipe(wake) != 0){
+        return false;
+    }
+    thread = std::thread(&MetricsRegistry::run, this);
+    return true;
+}
+
+void MetricsRegistry::stop(){
+    if(thread.joinable()){
+        char byte = 0;
+        if(write(wake[1], &byte, 1) == 1){
+            thread.join();
+        }
+        else{
+            thread.detach();
+        }
+    }
+    for(int &end : wake){
+        if(end >= 0){
+            close(end);
+            end = -1;
+        }
+    }
+    if(listener >= 0){
+        close(listener);
+        unlink(path.c_str());
+        listener = -1;
+    }
+    else if(!path.empty() && !dump()){
+        std::cerr << "ERROR::METRICS::WRITE_FAILED " << path << std::endl;
+    }
+    path.clear();
+}
+
+void MetricsRegistry::run(){
+    pollfd fds[2] = {
+        { wake[0], POLLIN, 0 },
+        { listener, POLLIN, 0 },
+    };
+    int count = listener >= 0 ? 2 : 1;
+    for(;;){
+        // the file is rewritten every interval, the socket waits for clients
+        int ready = poll(fds, count, listener >= 0 ? -1 : interval * 1000);
+        if(ready < 0){
+            continue;
+        }
+        if(fds[0].revents){
+            return;
+        }
+        if(count == 2 && fds[1].revents){
+            int client = accept(listener, nullptr, nullptr);
+            if(client >= 0){
+                serve(client);
+                close(client);
+            }
+        }
+        else if(ready == 0 && !dump()){
+            std::cerr << "ERROR::METRICS::WRITE_FAILED " << path << std::endl;
+        }
+    }
+}
+
+bool MetricsRegistry::dump(){
+    // write a new file and move it over the old one so readers never see half
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary);
+        if(!out){
+            return false;
+        }
+        if(json){
+            write_json(out);
+        }
+        else{
+            write_prometheus(out);
+        }
+        if(!out){
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+void MetricsRegistry::serve(int client){
+    // answer plain connections and HTTP scrapes alike: drain whatever request
+    // arrived without waiting for more, then reply as HTTP
+    char request[1024];
+    pollfd in = { client, POLLIN, 0 };
+    if(poll(&in, 1, 100) > 0){
+        if(read(client, request, sizeof(request)) < 0){
+            return;
+        }
+    }
+    std::ostringstream body;
+    write_prometheus(body);
+    std::string text = body.str();
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+             << text.size() << "\r\n\r\n" << text;
+    std::string bytes = response.str();
+    size_t sent = 0;
+    while(sent < bytes.size()){
+        ssize_t n = send(client, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if(n <= 0){
+            return;
+        }
+        sent += n;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define METRICS_HISTOGRAM_BUCKETS 12
+#define METRICS_DEFAULT_INTERVAL 10     // seconds between file dumps
+
+// monotonic count, safe to bump from any thread
+class Counter {
+    public:
+        void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+        void set(uint64_t n) { value.store(n, std::memory_order_relaxed); }     // mirror a count kept elsewhere
+        uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> value{};
+};
+
+// cumulative buckets over fixed upper bounds, plus +Inf
+class Histogram {
+    public:
+        void observe(double value);
+        std::vector<double> bounds;
+        std::atomic<uint64_t> counts[METRICS_HISTOGRAM_BUCKETS + 1]{};
+        std::atomic<uint64_t> sum_millionths{};     // sum of observations in millionths
+};
+
+// named counters and histograms of one process. Registration happens at
+// startup under a lock; updates are relaxed atomics, so the emulator thread
+// never waits for an export. A background thread writes everything in the
+// Prometheus text format or as JSON, either to a file every few seconds or
+// to each client of a Unix socket:
+//   --metrics chip8.prom   --metrics chip8.json   --metrics unix:/run/chip8.sock
+class MetricsRegistry {
+    public:
+        ~MetricsRegistry();
+        Counter& counter(const std::string &name, const std::string &help);
+        Histogram& histogram(const std::string &name, const std::string &help, const std::vector<double> &bounds);
+        bool start(const std::string &target, int interval_seconds);
+        void stop();                        // final dump to a file target
+        void write_prometheus(std::ostream &out) const;
+        void write_json(std::ostream &out) const;
+
+    private:
+        struct Entry {
+            std::string name, help;
+            Counter counter;
+            Histogram histogram;
+            bool is_histogram{};
+        };
+
+        void run();
+        bool dump();                        // write the file target atomically
+        void serve(int client);
+
+        mutable std::mutex lock;            // guards entries, not their values
+        std::deque<Entry> entries;          // stable addresses
+        std::string path;                   // file or socket
+        bool socket_target{};
+        bool json{};
+        int interval{METRICS_DEFAULT_INTERVAL};
+        int listener{-1};
+        int wake[2]{-1, -1};                // pipe used to stop the thread
+        std::thread thread;
+};
+
+// registry of this process
+MetricsRegistry &metrics();
+
+#endif
@@ -0,0 +1,230 @@
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "movie.hpp"
+
+#define MOVIE_MAGIC "C8MV"
+
+uint64_t rom_hash(const uint8_t *rom, size_t size){
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < size; i++){
+        hash = (hash ^ rom[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool rom_file_hash(const char *path, uint64_t &hash){
+    std::ifstream file(path, std::ios::binary);
+    if(!file){
+        return false;
+    }
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    hash = rom_hash(rom.data(), rom.size());
+    return true;
+}
+
+// little endian and LEB128 readers over the loaded file
+struct Reader {
+    const std::vector<uint8_t> &bytes;
+    size_t at;
+    bool ok;
+
+    uint64_t fixed(int n){
+        uint64_t value = 0;
+        for(int i = 0; i < n; i++){
+            if(at >= bytes.size()){
+                ok = false;
+                return 0;
+            }
+            value |= (uint64_t)bytes[at++] << (8 * i);
+        }
+        return value;
+    }
+    uint64_t varint(){
+        uint64_t value = 0;
+        for(int shift = 0; shift < 64; shift += 7){
+            if(at >= bytes.size()){
+                break;
+            }
+            uint8_t byte = bytes[at++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if(!(byte & 0x80)){
+                return value;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+bool load_movie(const char *path, Movie &movie){
+    std::ifstream file(path, std::ios::binary);
+    if(!file){
+        std::cerr << "ERROR::MOVIE::FILE_NOT_READ " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if(bytes.size() < 5 || std::string(bytes.begin(), bytes.begin() + 4) != MOVIE_MAGIC){
+        std::cerr << "ERROR::MOVIE::NOT_A_MOVIE " << path << std::endl;
+        return false;
+    }
+    if(bytes[4] != MOVIE_VERSION){
+        std::cerr << "ERROR::MOVIE::VERSION " << (int)bytes[4] << " in " << path << std::endl;
+        return false;
+    }
+
+    Reader in{bytes, 5, true};
+    movie.rom_hash = in.fixed(8);
+    movie.seed = (uint32_t)in.fixed(4);
+    movie.events.clear();
+    uint64_t cycle = 0;
+    while(in.ok && in.at < bytes.size()){
+        MovieEvent event{};
+        event.type = (char)bytes[in.at++];
+        event.cycle = cycle + in.varint();
+        if(event.type == 'K'){
+            event.keys = (uint16_t)in.fixed(2);
+        }
+        else if(event.type == 'H'){
+            event.hash = in.fixed(8);
+        }
+        else if(event.type != 'E'){
+            in.ok = false;
+            break;
+        }
+        if(!in.ok){
+            break;
+        }
+        cycle = event.cycle;
+        movie.events.push_back(event);
+        if(event.type == 'E'){
+            movie.cycles = cycle;
+            return true;
+        }
+    }
+    // a recording cut short by a crash still replays up to its last event
+    std::cerr << "ERROR::MOVIE::TRUNCATED " << path << " after " << movie.events.size() << " events" << std::endl;
+    movie.cycles = cycle;
+    movie.events.push_back(MovieEvent{cycle, 'E', 0, 0});
+    return true;
+}
+
+MovieWriter::~MovieWriter(){
+    if(file){
+        std::fclose(file);
+    }
+}
+
+bool MovieWriter::open(const char *path, uint64_t rom_hash, uint32_t seed){
+    file = std::fopen(path, "wb");
+    if(!file){
+        return false;
+    }
+    uint8_t header[17] = { 'C', '8', 'M', 'V', MOVIE_VERSION };
+    for(int i = 0; i < 8; i++){
+        header[5 + i] = rom_hash >> (8 * i);
+    }
+    for(int i = 0; i < 4; i++){
+        header[13 + i] = seed >> (8 * i);
+    }
+    std::fwrite(header, 1, sizeof(header), file);
+    bytes = sizeof(header);
+    return true;
+}
+
+void MovieWriter::event(char type, uint64_t cycle){
+    uint8_t out[11];
+    int n = 0;
+    out[n++] = type;
+    uint64_t delta = cycle - last_cycle;
+    do{
+        out[n] = delta & 0x7F;
+        delta >>= 7;
+        out[n++] |= delta ? 0x80 : 0;
+    }while(delta);
+    std::fwrite(out, 1, n, file);
+    bytes += n;
+    last_cycle = cycle;
+}
+
+void MovieWriter::keys(uint64_t cycle, const uint8_t key[16]){
+    uint16_t mask = 0;
+    for(int k = 0; k < 16; k++){
+        mask |= (key[k] ? 1 : 0) << k;
+    }
+    uint16_t changed = mask ^ last_keys;
+    if(!file || !changed){
+        return;
+    }
+    event('K', cycle);
+    uint8_t out[2] = { (uint8_t)changed, (uint8_t)(changed >> 8) };
+    std::fwrite(out, 1, 2, file);
+    bytes += 2;
+    last_keys = mask;
+    key_events++;
+}
+
+void MovieWriter::checkpoint(uint64_t cycle, uint64_t hash){
+    if(!file){
+        return;
+    }
+    event('H', cycle);
+    uint8_t out[8];
+    for(int i = 0; i < 8; i++){
+        out[i] = hash >> (8 * i);
+    }
+    std::fwrite(out, 1, 8, file);
+    bytes += 8;
+    checkpoints++;
+    std::fflush(file);
+}
+
+void MovieWriter::close(uint64_t cycle){
+    if(!file){
+        return;
+    }
+    event('E', cycle);
+    std::fclose(file);
+    file = nullptr;
+}
+
+void MovieWriter::report(std::ostream &out) const{
+    out << "input movie: " << last_cycle << " instructions, " << key_events << " key changes, "
+        << checkpoints << " checkpoints, " << bytes << " bytes\n";
+}
+
+void MoviePlayer::start(Chip8 &chip8){
+    chip8.seed(movie.seed);
+    for(int k = 0; k < 16; k++){
+        chip8.key[k] = 0;
+    }
+}
+
+unsigned long MoviePlayer::apply(Chip8 &chip8, unsigned long limit){
+    while(next < movie.events.size() && movie.events[next].cycle <= cycle){
+        const MovieEvent &event = movie.events[next++];
+        if(event.type == 'K'){
+            keys ^= event.keys;
+            for(int k = 0; k < 16; k++){
+                chip8.key[k] = (keys >> k) & 1;
+            }
+        }
+        else if(event.type == 'H'){
+            checkpoints++;
+            if(chip8.state_hash() != event.hash){
+                expected = event.hash;
+                diverged = true;
+                return 0;
+            }
+        }
+        else{
+            ended = true;
+            return 0;
+        }
+    }
+    if(next < movie.events.size() && movie.events[next].cycle - cycle < limit){
+        return movie.events[next].cycle - cycle;
+    }
+    return limit;
+}
@@ -0,0 +1,95 @@
+#ifndef MOVIE_HPP
+#define MOVIE_HPP
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "chip8.hpp"
+
+#define MOVIE_VERSION 1
+#define MOVIE_CHECKPOINT_CYCLES 6000    // instructions between recorded state hashes
+
+// input movie: all a run depends on besides the ROM, so replaying it redoes
+// the run exactly. Time is counted in instructions executed, the unit the
+// emulator is deterministic in, rather than in wall clock frames.
+//   header  "C8MV", version byte, ROM hash (8 bytes), CXNN seed (4 bytes), little endian
+//   events  type byte, instructions since the previous event as a LEB128 varint, then
+//             'K' 2 bytes: the keys that changed, bit n for key n
+//             'H' 8 bytes: Chip8::state_hash() there
+//             'E' nothing, the run ended
+struct MovieEvent {
+    uint64_t cycle;                     // instructions run before it
+    char     type;
+    uint16_t keys;
+    uint64_t hash;
+};
+
+struct Movie {
+    uint64_t rom_hash{};
+    uint32_t seed{};
+    uint64_t cycles{};                  // where the end event is
+    std::vector<MovieEvent> events;
+};
+
+uint64_t rom_hash(const uint8_t *rom, size_t size);     // 64-bit FNV-1a
+bool rom_file_hash(const char *path, uint64_t &hash);
+
+// false, with a message on stderr, if the file is missing or not a movie;
+// one cut short by a crash ends after its last whole event
+bool load_movie(const char *path, Movie &movie);
+
+// records as the run goes; stdio buffers the events and every checkpoint
+// flushes them, so a crash loses little
+class MovieWriter {
+    public:
+        ~MovieWriter();
+        bool open(const char *path, uint64_t rom_hash, uint32_t seed);
+        void keys(uint64_t cycle, const uint8_t key[16]);  // only when they changed
+        void checkpoint(uint64_t cycle, uint64_t hash);
+        void close(uint64_t cycle);
+        void report(std::ostream &out) const;
+
+    private:
+        void event(char type, uint64_t cycle);
+
+        FILE *file{};
+        uint64_t last_cycle{};
+        uint16_t last_keys{};
+        unsigned long key_events{}, checkpoints{};
+        unsigned long bytes{};
+};
+
+// feeds a movie's key changes to a Chip8 that runs in between and checks its
+// hashes at the checkpoints. The caller runs the instructions, with whatever
+// Chip8::step() policy it likes:
+//   while(!player.finished()){
+//       unsigned long n = player.apply(chip8, limit);
+//       ...run n instructions...
+//       player.advance(n);
+//   }
+class MoviePlayer {
+    public:
+        explicit MoviePlayer(const Movie &movie) : movie(movie) {}
+        void start(Chip8 &chip8);       // after the ROM is loaded: seed and release the keys
+        // applies the events due now and returns how many instructions, at
+        // most limit, run before the next one
+        unsigned long apply(Chip8 &chip8, unsigned long limit);
+        void advance(unsigned long n) { cycle += n; }
+        bool finished() const { return ended || diverged; }
+        bool mismatch() const { return diverged; }
+        uint64_t position() const { return cycle; }
+        uint64_t expected_hash() const { return expected; }
+        unsigned long checked() const { return checkpoints; }
+
+    private:
+        const Movie &movie;
+        size_t next{};
+        uint64_t cycle{};
+        uint16_t keys{};
+        bool ended{}, diverged{};
+        uint64_t expected{};            // hash at the first checkpoint that failed
+        unsigned long checkpoints{};
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <algorithm>
+#include <vector>
+
+#include "offscreen_renderer.hpp"
+#include "gl_util.hpp"
+#include "png_writer.hpp"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+OffscreenRenderer::~OffscreenRenderer(){
+    if(context == EGL_NO_CONTEXT){
+        return;
+    }
+    // capture exists once init got through, so there is a frame worth saving
+    if(capture && !screenshot.empty() && !save_screenshot()){
+        std::cerr << "ERROR::OFFSCREEN::SCREENSHOT_NOT_WRITTEN " << screenshot << std::endl;
+    }
+    release();
+    glDeleteFramebuffers(1, &target);
+    glDeleteRenderbuffers(1, &color);
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(surface != EGL_NO_SURFACE){
+        eglDestroySurface(display, surface);
+    }
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+}
+
+bool OffscreenRenderer::open_context(const Options &options, StartupTimer &startup){
+    width = VIDEO_WIDTH * options.scale;
+    height = VIDEO_HEIGHT * options.scale;
+    screenshot = options.screenshot ? options.screenshot : "";
+    limit = options.frames ? 0 : WINDOWLESS_FRAMES;
+
+    // the surfaceless platform needs neither a display server nor a GPU,
+    // fall back to the default display where it is missing
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay){
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)){
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)){
+            std::cout << "Failed to initialize EGL" << std::endl;
+            return false;
+        }
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configs = 0;
+    if(!eglChooseConfig(display, config_attributes, &config, 1, &configs) || configs == 0){
+        std::cout << "Failed to find an EGL config" << std::endl;
+        return false;
+    }
+    EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+    if(context == EGL_NO_CONTEXT){
+        std::cout << "Failed to create EGL context" << std::endl;
+        return false;
+    }
+    // everything is drawn into our own framebuffer, so a surface is only
+    // created for drivers without EGL_KHR_surfaceless_context
+    if(!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)){
+        EGLint surface_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, surface_attributes);
+        if(surface == EGL_NO_SURFACE || !eglMakeCurrent(display, surface, surface, context)){
+            std::cout << "Failed to make the EGL context current" << std::endl;
+            return false;
+        }
+    }
+    startup.mark("EGL context");
+
+    loader = (GLADloadproc)eglGetProcAddress;
+    if(!gladLoadGLLoader(loader)){
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    startup.mark("glad load");
+
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &target);
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+        std::cout << "ERROR::OFFSCREEN::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        return false;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+void OffscreenRenderer::present(){
+    // nothing to swap; make sure the frame is on its way
+    glFlush();
+    presents++;
+}
+
+bool OffscreenRenderer::save_screenshot(){
+    std::vector<uint32_t> pixels((size_t)width * height);
+    std::vector<uint32_t> flipped(pixels.size());
+    gl_state().bind_framebuffer(target);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    for(int y = 0; y < height; y++){
+        std::copy(pixels.begin() + (size_t)(height - 1 - y) * width, pixels.begin() + (size_t)(height - y) * width,
+                  flipped.begin() + (size_t)y * width);
+    }
+    return write_png(screenshot, flipped.data(), width, height);
+}
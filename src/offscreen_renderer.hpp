@@ -0,0 +1,37 @@
+#ifndef OFFSCREEN_RENDERER_HPP
+#define OFFSCREEN_RENDERER_HPP
+#include <EGL/egl.h>
+
+#include "gl_renderer.hpp"
+
+// the GL renderer without a window: an EGL context on Mesa's surfaceless
+// platform (llvmpipe works, no display server or GPU needed) drawing into a
+// framebuffer object. Frames come out through --record and --screenshot,
+// which makes the shader chain testable on headless machines. Like the null
+// renderer it stops without --frames once the ROM halts, or after
+// WINDOWLESS_FRAMES.
+class OffscreenRenderer : public GlRenderer {
+    public:
+        ~OffscreenRenderer();
+        bool should_close() override { return limit && (halted || presents >= limit); }
+        void process_input(Chip8 &chip8, LatencyTracker*) override { halted = chip8.halted(); }
+        void present() override;
+
+    protected:
+        bool open_context(const Options &options, StartupTimer &startup) override;
+        void output_size(int &w, int &h) override { w = width; h = height; }
+
+    private:
+        bool save_screenshot();
+
+        EGLDisplay display{EGL_NO_DISPLAY};
+        EGLContext context{EGL_NO_CONTEXT};
+        EGLSurface surface{EGL_NO_SURFACE};  // only if the driver needs one
+        unsigned int color{};               // renderbuffer behind target
+        int width{}, height{};
+        std::string screenshot;             // written from the last frame on exit
+        long presents{}, limit{};           // 0 with --frames, which main counts exactly
+        bool halted{};
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <iomanip>
+#include <utility>
+#include <vector>
+
+#include "opcode_profile.hpp"
+
+static const char *family_names[OPCODE_FAMILIES] = {
+    "00E0", "00EE", "0NNN", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+    "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+    "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+    "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+    "invalid",
+};
+#define INVALID (OPCODE_FAMILIES - 1)
+
+int opcode_family(uint16_t opcode){
+    switch(opcode >> 12){
+        case 0x0:
+            return opcode == 0x00E0 ? 0 : opcode == 0x00EE ? 1 : 2;
+        case 0x8:{
+            static const int low[16] = { 10, 11, 12, 13, 14, 15, 16, 17, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, 18, INVALID };
+            return low[opcode & 0xF];
+        }
+        case 0xE:
+            return (opcode & 0xFF) == 0x9E ? 24 : (opcode & 0xFF) == 0xA1 ? 25 : INVALID;
+        case 0xF:
+            switch(opcode & 0xFF){
+                case 0x07: return 26;
+                case 0x0A: return 27;
+                case 0x15: return 28;
+                case 0x18: return 29;
+                case 0x1E: return 30;
+                case 0x29: return 31;
+                case 0x33: return 32;
+                case 0x55: return 33;
+                case 0x65: return 34;
+            }
+            return INVALID;
+        default:{
+            // one handler per leading nibble
+            static const int high[16] = { 0, 3, 4, 5, 6, 7, 8, 9, 0, 19, 20, 21, 22, 23, 0, 0 };
+            return high[opcode >> 12];
+        }
+    }
+}
+
+const char *opcode_family_name(int family){
+    return family >= 0 && family < OPCODE_FAMILIES ? family_names[family] : "?";
+}
+
+// indices of the largest counts, largest first
+static std::vector<std::pair<uint64_t, int>> top(const uint64_t *counts, int n){
+    std::vector<std::pair<uint64_t, int>> rows;
+    for(int i = 0; i < n; i++){
+        if(counts[i]){
+            rows.push_back(std::make_pair(counts[i], i));
+        }
+    }
+    size_t keep = std::min(rows.size(), (size_t)OPCODE_PROFILE_TOP);
+    std::partial_sort(rows.begin(), rows.begin() + keep, rows.end(),
+                      [](const std::pair<uint64_t, int> &a, const std::pair<uint64_t, int> &b){ return a.first > b.first; });
+    rows.resize(keep);
+    return rows;
+}
+
+void OpcodeProfile::report(std::ostream &out) const{
+    out << "opcode profile: " << total << " instructions\n";
+    if(!total){
+        return;
+    }
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(2);
+    auto share = [&](uint64_t count){ return 100.0 * count / total; };
+
+    out << "  per handler:\n";
+    for(const auto &row : top(families, OPCODE_FAMILIES)){
+        out << "    " << std::setw(7) << std::left << opcode_family_name(row.second) << std::right
+            << std::setw(12) << row.first << std::setw(8) << share(row.first) << "%\n";
+    }
+
+    out << "  hottest addresses:\n";
+    for(const auto &row : top(at_pc, 4096)){
+        out << "    0x" << std::hex << std::setfill('0') << std::setw(3) << row.second
+            << "  " << std::uppercase << std::setw(4) << opcode_at[row.second] << std::nouppercase
+            << std::dec << std::setfill(' ') << "  " << std::setw(7) << std::left << opcode_family_name(opcode_family(opcode_at[row.second]))
+            << std::right << std::setw(12) << row.first << std::setw(8) << share(row.first) << "%\n";
+    }
+
+    out << "  pairs:\n";
+    for(const auto &row : top(pairs, OPCODE_FAMILIES * OPCODE_FAMILIES)){
+        int first = row.second / OPCODE_FAMILIES, second = row.second % OPCODE_FAMILIES;
+        out << "    " << opcode_family_name(first) << " " << std::setw(7) << std::left << opcode_family_name(second)
+            << std::right << std::setw(12) << row.first << std::setw(8) << share(row.first) << "%\n";
+    }
+
+    out << "  triples:\n";
+    for(const auto &row : top(triples, OPCODE_FAMILIES * OPCODE_FAMILIES * OPCODE_FAMILIES)){
+        int first = row.second / (OPCODE_FAMILIES * OPCODE_FAMILIES);
+        int second = row.second / OPCODE_FAMILIES % OPCODE_FAMILIES, third = row.second % OPCODE_FAMILIES;
+        out << "    " << opcode_family_name(first) << " " << opcode_family_name(second) << " "
+            << std::setw(7) << std::left << opcode_family_name(third)
+            << std::right << std::setw(7) << row.first << std::setw(8) << share(row.first) << "%\n";
+    }
+    out.flags(flags);
+}
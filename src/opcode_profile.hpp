@@ -0,0 +1,64 @@
+#ifndef OPCODE_PROFILE_HPP
+#define OPCODE_PROFILE_HPP
+#include <cstdint>
+#include <iostream>
+
+#define OPCODE_FAMILIES 36              // every handler plus one for invalid opcodes
+#define OPCODE_PROFILE_TOP 20           // rows per table in the report
+
+// index of the OP_* handler an opcode dispatches to, and its name ("DXYN")
+int opcode_family(uint16_t opcode);
+const char *opcode_family_name(int family);
+
+// policies for Chip8::step(), told about every instruction and the index
+// register before it runs. NoProfile does nothing and inlines away, which is
+// all cycle() is.
+struct NoProfile {
+    void instruction(uint16_t, uint16_t, uint16_t) {}
+};
+
+// runs two policies side by side
+template<typename First, typename Second>
+struct ProfilePair {
+    First &first;
+    Second &second;
+    void instruction(uint16_t pc, uint16_t opcode, uint16_t index){
+        first.instruction(pc, opcode, index);
+        second.instruction(pc, opcode, index);
+    }
+};
+
+// counts instructions per handler and per address, and which handlers follow
+// each other in pairs and triples, to show which OP_* handlers and fused
+// sequences are worth optimizing. Fixed arrays, no allocation while running.
+class OpcodeProfile {
+    public:
+        void instruction(uint16_t pc, uint16_t opcode, uint16_t){
+            int family = opcode_family(opcode);
+            families[family]++;
+            pc &= 0xFFF;
+            at_pc[pc]++;
+            opcode_at[pc] = opcode;
+            if(total >= 1){
+                pairs[previous[1] * OPCODE_FAMILIES + family]++;
+            }
+            if(total >= 2){
+                triples[(previous[0] * OPCODE_FAMILIES + previous[1]) * OPCODE_FAMILIES + family]++;
+            }
+            previous[0] = previous[1];
+            previous[1] = family;
+            total++;
+        }
+        void report(std::ostream &out) const;
+
+    private:
+        uint64_t total{};
+        uint64_t families[OPCODE_FAMILIES]{};
+        uint64_t at_pc[4096]{};
+        uint16_t opcode_at[4096]{};         // last opcode fetched there
+        uint64_t pairs[OPCODE_FAMILIES * OPCODE_FAMILIES]{};
+        uint64_t triples[OPCODE_FAMILIES * OPCODE_FAMILIES * OPCODE_FAMILIES]{};
+        int previous[2]{};                  // families of the last two instructions, oldest first
+};
+
+#endif
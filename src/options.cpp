@@ -0,0 +1,153 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "options.hpp"
+#include "frame_stats.hpp"
+
+static void usage(const char *program){
+    std::cerr << "Usage: " << program << " <Cycle Delay> <ROM> [options]\n"
+              << "  --renderer <name>   gl (default), offscreen (EGL, no window), soft (terminal, no GL needed) or null\n"
+              << "  --frames <n>        exit after n frames (null, offscreen: when the ROM halts, at most 600)\n"
+              << "  --scale <n>         soft and offscreen renderers: integer upscale (default 1)\n"
+              << "  --palette <off,on>  soft renderer: RRGGBB colors of dark and lit pixels\n"
+              << "  --phosphor <decay>  soft renderer: brightness kept per frame, 0 for none (default 0.6)\n"
+              << "  --record <path>     record to a .y4m file or a PNG pattern like out/%05d.png (gl: F9 toggles)\n"
+              << "  --metrics <target>  export counters to a .json or Prometheus text file, or unix:<socket>\n"
+              << "  --metrics-interval <s>  seconds between metrics file dumps (default 10)\n"
+              << "  --trace <json>      write a Chrome/Perfetto trace of the loop on exit and on SIGUSR1\n"
+              << "  --screenshot <png>  offscreen renderer: save the last frame on exit\n"
+              << "  --cycles-per-frame <n>  chip8-headless: instructions per 60 Hz frame\n"
+              << "  --seed <n>          seed of the CXNN random numbers (default: the clock)\n"
+              << "  --record-input <movie>  record key changes and state hashes to replay the run exactly\n"
+              << "  --checkpoint-interval <n>  instructions between state hashes in the movie (default " << MOVIE_CHECKPOINT_CYCLES << ", 0 for none)\n"
+              << "  --replay <movie>    chip8-headless: play a recorded movie back as fast as possible and check its hashes\n"
+              << "  --latency           report input-to-photon latency on exit\n"
+              << "  --upload-stats      report screen texture upload cost on exit\n"
+              << "  --preset <file>     post-processing preset (default " DEFAULT_PRESET ")\n"
+              << "  --gpu-budget <ms>   GPU time allowed for post-processing per frame\n"
+              << "  --pass-stats        report per pass GPU timings on exit\n"
+              << "  --frame-stats       log CPU and GPU time per part of the frame every " << FRAME_STATS_LOG_SECONDS << " s\n"
+              << "  --opcode-stats      count instructions per handler, address and 2/3-instruction sequence\n"
+              << "  --hud               show the performance overlay from the start (F1 toggles it)\n"
+              << "  --heatmap           gl: show a live map of memory reads, writes and executes (F2 toggles it)\n"
+              << "  --shader-dir <dir>  load shaders and presets from dir instead of the built-in copies\n"
+              << "  --hot-reload        rebuild shaders when files in the shader dir (default " SHADER_DIR ") change\n"
+              << "  --no-shader-cache   always compile shaders instead of loading cached binaries\n"
+              << "  --startup-times     print how long each startup stage took\n";
+    std::exit(EXIT_FAILURE);
+}
+
+void parse_options(int argc, char **argv, Options &options){
+    if(argc < 3){
+        usage(argv[0]);
+    }
+    options.cycle_delay = std::atoi(argv[1]);
+    options.rom = argv[2];
+
+    // optional flags after the ROM
+    for(int i = 3; i < argc; i++){
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if(std::strcmp(arg, "--renderer") == 0 && has_value){
+            options.renderer = argv[++i];
+        }
+        else if(std::strcmp(arg, "--frames") == 0 && has_value){
+            options.frames = std::atol(argv[++i]);
+        }
+        else if(std::strcmp(arg, "--scale") == 0 && has_value){
+            options.scale = std::atoi(argv[++i]);
+        }
+        else if(std::strcmp(arg, "--palette") == 0 && has_value){
+            std::string colors = argv[++i];
+            size_t comma = colors.find(',');
+            if(comma == std::string::npos ||
+               !parse_color(colors.substr(0, comma).c_str(), options.palette_off) ||
+               !parse_color(colors.substr(comma + 1).c_str(), options.palette_on)){
+                std::cerr << "Bad palette: " << colors << "\n";
+                usage(argv[0]);
+            }
+        }
+        else if(std::strcmp(arg, "--phosphor") == 0 && has_value){
+            options.phosphor = (float)std::atof(argv[++i]);
+        }
+        else if(std::strcmp(arg, "--record") == 0 && has_value){
+            options.record = argv[++i];
+        }
+        else if(std::strcmp(arg, "--metrics") == 0 && has_value){
+            options.metrics = argv[++i];
+        }
+        else if(std::strcmp(arg, "--metrics-interval") == 0 && has_value){
+            options.metrics_interval = std::atoi(argv[++i]);
+        }
+        else if(std::strcmp(arg, "--trace") == 0 && has_value){
+            options.trace = argv[++i];
+        }
+        else if(std::strcmp(arg, "--screenshot") == 0 && has_value){
+            options.screenshot = argv[++i];
+        }
+        else if(std::strcmp(arg, "--cycles-per-frame") == 0 && has_value){
+            options.cycles_per_frame = std::atoi(argv[++i]);
+        }
+        else if(std::strcmp(arg, "--seed") == 0 && has_value){
+            options.seed = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        }
+        else if(std::strcmp(arg, "--record-input") == 0 && has_value){
+            options.record_input = argv[++i];
+        }
+        else if(std::strcmp(arg, "--checkpoint-interval") == 0 && has_value){
+            options.checkpoint_interval = std::strtoul(argv[++i], nullptr, 0);
+        }
+        else if(std::strcmp(arg, "--replay") == 0 && has_value){
+            options.replay = argv[++i];
+        }
+        else if(std::strcmp(arg, "--latency") == 0){
+            options.latency = true;
+        }
+        else if(std::strcmp(arg, "--upload-stats") == 0){
+            options.upload_stats = true;
+        }
+        else if(std::strcmp(arg, "--preset") == 0 && has_value){
+            options.preset = argv[++i];
+        }
+        else if(std::strcmp(arg, "--gpu-budget") == 0 && has_value){
+            options.gpu_budget = std::atof(argv[++i]);
+        }
+        else if(std::strcmp(arg, "--pass-stats") == 0){
+            options.pass_stats = true;
+        }
+        else if(std::strcmp(arg, "--frame-stats") == 0){
+            options.frame_stats = true;
+        }
+        else if(std::strcmp(arg, "--opcode-stats") == 0){
+            options.opcode_stats = true;
+        }
+        else if(std::strcmp(arg, "--hud") == 0){
+            options.hud = true;
+        }
+        else if(std::strcmp(arg, "--heatmap") == 0){
+            options.heatmap = true;
+        }
+        else if(std::strcmp(arg, "--hot-reload") == 0){
+            options.hot_reload = true;
+        }
+        else if(std::strcmp(arg, "--no-shader-cache") == 0){
+            options.shader_cache = false;
+        }
+        else if(std::strcmp(arg, "--shader-dir") == 0 && has_value){
+            options.shader_dir = argv[++i];
+        }
+        else if(std::strcmp(arg, "--startup-times") == 0){
+            options.startup_times = true;
+        }
+        else{
+            std::cerr << "Unknown option: " << arg << "\n";
+            usage(argv[0]);
+        }
+    }
+
+    // hot reload watches files, so it needs shaders on disk
+    if(options.hot_reload && !options.shader_dir){
+        options.shader_dir = SHADER_DIR;
+    }
+}
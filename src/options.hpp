@@ -0,0 +1,54 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+#include <cstdint>
+#include <string>
+
+#include "movie.hpp"
+#include "soft_raster.hpp"
+
+#define SHADER_DIR "shaders/"
+#define DEFAULT_PRESET "presets/default.preset"
+#define DEFAULT_GPU_BUDGET_MS 2.0
+#define DEFAULT_PHOSPHOR 0.6f
+
+// command line shared by the frontends:
+//   chip8 <Cycle Delay> <ROM> [options]
+//   chip8-headless <Cycle Delay> <ROM> [options]
+struct Options {
+    int         cycle_delay{};
+    const char *rom{};
+    std::string renderer{"gl"};         // gl, offscreen, soft or null
+    long        frames{};               // stop after this many frames, 0 runs until closed
+    bool        latency{};
+    bool        upload_stats{};
+    bool        pass_stats{};
+    bool        frame_stats{};
+    bool        opcode_stats{};         // report handler, address and sequence counts on exit
+    bool        hud{};                  // start with the performance overlay shown
+    bool        heatmap{};              // show memory reads, writes and executes
+    bool        hot_reload{};
+    bool        shader_cache{true};
+    bool        startup_times{};
+    const char *shader_dir{};           // nullptr: built-in shaders
+    const char *preset{DEFAULT_PRESET};
+    double      gpu_budget{DEFAULT_GPU_BUDGET_MS};
+    int         scale{1};               // soft and offscreen renderers
+    uint32_t    palette_off{SOFT_PALETTE_OFF};
+    uint32_t    palette_on{SOFT_PALETTE_ON};
+    float       phosphor{DEFAULT_PHOSPHOR};
+    const char *record{};               // .y4m file or PNG name pattern
+    const char *metrics{};              // file (.json or Prometheus text) or unix:<socket>
+    int         metrics_interval{};     // seconds between file dumps, 0 for the default
+    const char *trace{};                // Chrome trace JSON of the loop
+    const char *screenshot{};           // offscreen renderer: PNG of the last frame
+    int         cycles_per_frame{};     // chip8-headless: 0 derives it from the cycle delay
+    uint32_t    seed{};                 // CXNN random numbers, 0 seeds from the clock
+    const char *record_input{};         // input movie to write
+    const char *replay{};               // chip8-headless: input movie to play back
+    unsigned long checkpoint_interval{MOVIE_CHECKPOINT_CYCLES};    // instructions between movie state hashes
+};
+
+// fills options from argv, printing usage and exiting on bad input
+void parse_options(int argc, char **argv, Options &options);
+
+#endif
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "png_writer.hpp"
+
+#define PNG_MAX_MATCH 258
+
+// deflate length codes 257..285: base length and extra bits
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+// deflate streams are packed least significant bit first
+struct BitWriter {
+    std::vector<uint8_t> &out;
+    uint64_t bits{};
+    int count{};
+
+    explicit BitWriter(std::vector<uint8_t> &out) : out(out) {}
+
+    void put(uint32_t value, int n){
+        bits |= (uint64_t)value << count;
+        count += n;
+        while(count >= 8){
+            out.push_back((uint8_t)bits);
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+    // Huffman codes are defined most significant bit first
+    void put_code(uint32_t code, int n){
+        uint32_t reversed = 0;
+        for(int i = 0; i < n; i++){
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        put(reversed, n);
+    }
+    void flush(){
+        if(count > 0){
+            out.push_back((uint8_t)bits);
+        }
+        bits = 0;
+        count = 0;
+    }
+};
+
+// fixed Huffman code of a literal/length symbol
+static void put_symbol(BitWriter &writer, int symbol){
+    if(symbol < 144){
+        writer.put_code(0x30 + symbol, 8);
+    }
+    else if(symbol < 256){
+        writer.put_code(0x190 + symbol - 144, 9);
+    }
+    else if(symbol < 280){
+        writer.put_code(symbol - 256, 7);
+    }
+    else{
+        writer.put_code(0xC0 + symbol - 280, 8);
+    }
+}
+
+static void put_match(BitWriter &writer, int length){
+    int code = 28;
+    while(length_base[code] > length){
+        code--;
+    }
+    put_symbol(writer, 257 + code);
+    writer.put(length - length_base[code], length_extra[code]);
+    writer.put_code(0, 5);          // distance code 0: one byte back
+}
+
+// streams bytes into a single fixed Huffman block, turning runs of a
+// repeated byte into distance 1 matches, and keeps the zlib checksum
+class RunDeflater {
+    public:
+        explicit RunDeflater(std::vector<uint8_t> &out) : writer(out) {
+            writer.put(1, 1);       // final block
+            writer.put(1, 2);       // fixed Huffman codes
+        }
+
+        void put(uint8_t byte){
+            if(started && byte == last){
+                if(++run == PNG_MAX_MATCH){
+                    flush_run();
+                }
+            }
+            else{
+                flush_run();
+                put_symbol(writer, byte);
+                last = byte;
+                started = true;
+            }
+            a += byte;
+            b += a;
+            if(++summed == 5552){   // the most that can be summed before b overflows
+                a %= 65521;
+                b %= 65521;
+                summed = 0;
+            }
+        }
+        // n copies of byte without touching them one by one
+        void repeat(uint8_t byte, size_t n){
+            if(!n){
+                return;
+            }
+            put(byte);
+            n--;
+            size_t total = run + n;
+            for(; total >= PNG_MAX_MATCH; total -= PNG_MAX_MATCH){
+                put_match(writer, PNG_MAX_MATCH);
+            }
+            run = total;
+            a %= 65521;
+            b = (uint32_t)((b + (uint64_t)a * (n % 65521) + (uint64_t)byte * ((n * (n + 1) / 2) % 65521)) % 65521);
+            a = (uint32_t)((a + (uint64_t)byte * (n % 65521)) % 65521);
+            summed = 0;
+        }
+        uint32_t finish(){
+            flush_run();
+            put_symbol(writer, 256);    // end of block
+            writer.flush();
+            return ((b % 65521) << 16) | (a % 65521);
+        }
+
+    private:
+        void flush_run(){
+            if(run >= 3){
+                put_match(writer, (int)run);
+            }
+            else{
+                for(size_t i = 0; i < run; i++){
+                    put_symbol(writer, last);
+                }
+            }
+            run = 0;
+        }
+
+        BitWriter writer;
+        uint8_t last{};
+        bool started{};
+        size_t run{};               // copies of last not yet written
+        uint32_t a{1}, b{};         // adler32
+        int summed{};
+};
+
+// filled once on first use; PNG frames are encoded on writer threads
+struct Crc32Table {
+    uint32_t entry[256];
+
+    Crc32Table(){
+        for(uint32_t n = 0; n < 256; n++){
+            uint32_t c = n;
+            for(int k = 0; k < 8; k++){
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entry[n] = c;
+        }
+    }
+};
+
+static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size){
+    static const Crc32Table table;
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++){
+        crc = table.entry[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void put_u32(std::vector<uint8_t> &out, uint32_t value){
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void put_chunk(std::vector<uint8_t> &png, const char *type, const std::vector<uint8_t> &data){
+    put_u32(png, (uint32_t)data.size());
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    put_u32(png, crc32(0, png.data() + start, png.size() - start));
+}
+
+void encode_png(const uint32_t *pixels, int width, int height, std::vector<uint8_t> &png){
+    // filtered scanlines: a filter type byte, then RGB
+    const size_t stride = (size_t)width * 3;
+    std::vector<uint8_t> zlib = { 0x78, 0x01 };
+    RunDeflater deflater(zlib);
+    for(int y = 0; y < height; y++){
+        const uint32_t *row = pixels + (size_t)y * width;
+        if(y > 0 && std::equal(row, row + width, row - width)){
+            deflater.put(2);        // Up: all zero
+            deflater.repeat(0, stride);
+            continue;
+        }
+        deflater.put(1);            // Sub
+        uint32_t left = 0;
+        for(int x = 0; x < width; x++){
+            uint32_t p = row[x];
+            deflater.put((uint8_t)(p - left));
+            deflater.put((uint8_t)((p >> 8) - (left >> 8)));
+            deflater.put((uint8_t)((p >> 16) - (left >> 16)));
+            left = p;
+        }
+    }
+    put_u32(zlib, deflater.finish());
+
+    std::vector<uint8_t> header;
+    put_u32(header, width);
+    put_u32(header, height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });    // 8 bit RGB, no interlace
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    png.assign(signature, signature + 8);
+    put_chunk(png, "IHDR", header);
+    put_chunk(png, "IDAT", zlib);
+    put_chunk(png, "IEND", std::vector<uint8_t>());
+}
+
+bool write_png(const std::string &path, const uint32_t *pixels, int width, int height){
+    std::vector<uint8_t> png;
+    encode_png(pixels, width, height, png);
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if(!file){
+        return false;
+    }
+    bool ok = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+    return std::fclose(file) == 0 && ok;
+}
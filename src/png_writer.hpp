@@ -0,0 +1,15 @@
+#ifndef PNG_WRITER_HPP
+#define PNG_WRITER_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// minimal PNG encoder for emulator frames, no zlib needed. Rows are filtered
+// with Up when they repeat the row above and Sub otherwise, which turns the
+// flat colors of upscaled pixel art into long runs of zeros. Those are
+// compressed as distance 1 matches in a single fixed Huffman deflate block.
+// pixels are 0xAABBGGRR (RGBA bytes in memory); alpha is dropped.
+void encode_png(const uint32_t *pixels, int width, int height, std::vector<uint8_t> &png);
+bool write_png(const std::string &path, const uint32_t *pixels, int width, int height);
+
+#endif
@@ -0,0 +1,278 @@
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "postprocess.hpp"
+#include "gl_util.hpp"
+
+// how often the chain is checked against its GPU budget, in frames
+#define BUDGET_CHECK_INTERVAL 60
+
+PostChain::~PostChain(){
+    for(Pass *pass : passes){
+        int targets = pass->feedback ? 2 : 1;
+        if(pass->fbo[0]){
+            glDeleteFramebuffers(targets, pass->fbo);
+            glDeleteTextures(targets, pass->tex);
+        }
+        if(pass->shader){
+            glDeleteProgram(pass->shader->ID);
+            delete pass->shader;
+        }
+        delete pass;
+    }
+}
+
+bool PostChain::parse(const std::string &text, const char *preset_path){
+    std::istringstream file(text);
+    std::string line;
+    int line_number = 0;
+    while(std::getline(file, line)){
+        line_number++;
+        std::istringstream tokens(line);
+        std::string keyword;
+        if(!(tokens >> keyword) || keyword[0] == '#'){
+            continue;
+        }
+
+        Pass *pass = new Pass();
+        std::string scale;
+        if(keyword != "pass" || !(tokens >> pass->file >> scale) || (scale != "source" && scale != "output")){
+            std::cout << "ERROR::POSTPROCESS::BAD_PRESET_LINE " << preset_path << ":" << line_number << std::endl;
+            delete pass;
+            return false;
+        }
+        pass->at_output = (scale == "output");
+
+        // flags and uniform values
+        std::string token;
+        while(tokens >> token){
+            if(token == "feedback"){
+                pass->feedback = true;
+            }
+            else if(token == "optional"){
+                pass->optional = true;
+            }
+            else if(token.find('=') != std::string::npos){
+                Uniform uniform;
+                uniform.name = token.substr(0, token.find('='));
+                std::istringstream values(token.substr(token.find('=') + 1));
+                std::string value;
+                bool numbers = true;
+                while(std::getline(values, value, ',') && uniform.value.size() < 4){
+                    char *end;
+                    float number = std::strtof(value.c_str(), &end);
+                    numbers = numbers && !value.empty() && !*end;
+                    uniform.value.push_back(number);
+                }
+                if(!numbers || uniform.value.empty()){
+                    std::cout << "ERROR::POSTPROCESS::BAD_PRESET_LINE " << preset_path << ":" << line_number << std::endl;
+                    delete pass;
+                    return false;
+                }
+                pass->uniforms.push_back(uniform);
+            }
+        }
+        passes.push_back(pass);
+    }
+    return !passes.empty();
+}
+
+bool PostChain::load(const char *preset_path, unsigned int quad){
+    vao = quad;
+
+    // a preset file given on the command line, else a built-in one
+    std::string text;
+    std::ifstream file(preset_path);
+    if(file.is_open()){
+        std::stringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+    }
+    else if(!shader_source_read(preset_path, text)){
+        std::cout << "ERROR::POSTPROCESS::PRESET_NOT_FOUND " << preset_path << std::endl;
+        return false;
+    }
+    if(!parse(text, preset_path)){
+        return false;
+    }
+    for(Pass *pass : passes){
+        pass->shader = new Shader("shader.vert", pass->file.c_str());
+    }
+    return true;
+}
+
+void PostChain::reload(const std::vector<std::string> &changed){
+    for(Pass *pass : passes){
+        for(const std::string &path : changed){
+            if(pass->shader->uses(path)){
+                pass->shader->reload();
+                break;
+            }
+        }
+    }
+}
+
+void PostChain::resize(Pass &pass, int w, int h){
+    if(pass.fbo[0] && pass.width == w && pass.height == h){
+        return;
+    }
+    int targets = pass.feedback ? 2 : 1;
+    if(!pass.fbo[0]){
+        glGenFramebuffers(targets, pass.fbo);
+        glGenTextures(targets, pass.tex);
+    }
+    for(int i = 0; i < targets; i++){
+        gl_state().bind_texture(0, pass.tex[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        // linear filtering so later passes can do sharp bilinear scaling
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        gl_state().bind_framebuffer(pass.fbo[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pass.tex[i], 0);
+        gl_state().viewport(0, 0, w, h);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    pass.width = w;
+    pass.height = h;
+}
+
+void PostChain::render(unsigned int source, int source_w, int source_h, int output_w, int output_h, unsigned int target){
+    // time since the previous frame, so feedback passes decay at the same
+    // rate however fast the loop spins
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    float frame_time = frames ? std::chrono::duration<float>(now - last_frame).count() : 0.0f;
+    last_frame = now;
+
+    int last = -1;
+    for(int i = 0; i < (int)passes.size(); i++){
+        if(passes[i]->enabled){
+            last = i;
+        }
+    }
+
+    unsigned int input = source;
+    int input_w = source_w, input_h = source_h;
+    for(int i = 0; i <= last; i++){
+        Pass &pass = *passes[i];
+        if(!pass.enabled){
+            continue;
+        }
+        pass.timer.poll();
+        pass.shader->poll_reload();
+
+        // the last pass goes straight to the window unless it must keep its output
+        bool to_window = (i == last);
+        bool to_texture = !to_window || pass.feedback;
+        int w = (pass.at_output || to_window) ? output_w : source_w;
+        int h = (pass.at_output || to_window) ? output_h : source_h;
+        if(to_texture){
+            resize(pass, w, h);
+            if(pass.feedback){
+                pass.current ^= 1;
+            }
+            gl_state().bind_framebuffer(pass.fbo[pass.current]);
+        }
+        else{
+            gl_state().bind_framebuffer(target);
+            pass.width = w;
+            pass.height = h;
+        }
+        gl_state().viewport(0, 0, w, h);
+
+        Shader &shader = *pass.shader;
+        gl_state().use_program(shader.ID);
+        gl_state().bind_texture(0, input);
+        shader.setInt("source", 0);
+        if(pass.feedback){
+            gl_state().bind_texture(1, pass.tex[pass.current ^ 1]);
+            shader.setInt("previous", 1);
+        }
+        shader.setVec2("sourceSize", (float)input_w, (float)input_h);
+        shader.setVec2("originalSize", (float)source_w, (float)source_h);
+        shader.setVec2("outputSize", (float)w, (float)h);
+        shader.setBool("toTexture", to_texture);
+        shader.setFloat("frameTime", frame_time);
+        for(const Uniform &uniform : pass.uniforms){
+            int location = shader.location(uniform.name);
+            const std::vector<float> &v = uniform.value;
+            switch(v.size()){
+                case 1: glUniform1f(location, v[0]); break;
+                case 2: glUniform2f(location, v[0], v[1]); break;
+                case 3: glUniform3f(location, v[0], v[1], v[2]); break;
+                case 4: glUniform4f(location, v[0], v[1], v[2], v[3]); break;
+            }
+        }
+
+        pass.timer.begin();
+        gl_state().bind_vertex_array(vao);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        if(to_window && to_texture){
+            // feedback pass at the end of the chain: copy its output to the window
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, pass.fbo[pass.current]);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+            glBlitFramebuffer(0, 0, w, h, 0, h, output_w, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            gl_state().bind_framebuffer(target);
+        }
+        pass.timer.end();
+
+        input = pass.tex[pass.current];
+        input_w = w;
+        input_h = h;
+    }
+    gl_state().bind_framebuffer(target);
+    gl_state().viewport(0, 0, output_w, output_h);
+
+    if(++frames % BUDGET_CHECK_INTERVAL == 0){
+        enforce_budget();
+    }
+}
+
+void PostChain::enforce_budget(){
+    double total = 0.0;
+    for(Pass *pass : passes){
+        if(pass->enabled){
+            total += pass->timer.average_ms();
+        }
+    }
+    if(total <= budget_ms){
+        return;
+    }
+
+    // drop the last optional pass still running
+    for(int i = (int)passes.size() - 1; i >= 0; i--){
+        if(passes[i]->enabled && passes[i]->optional){
+            passes[i]->enabled = false;
+            std::cout << "postprocess: " << std::fixed << std::setprecision(2) << total
+                      << " ms over the " << budget_ms << " ms budget, disabling " << passes[i]->file << std::endl;
+            return;
+        }
+    }
+}
+
+void PostChain::set_frame_stats(FrameStats *stats){
+    for(Pass *pass : passes){
+        pass->timer.record_to(&stats->timing("gpu " + pass->file));
+    }
+}
+
+void PostChain::report(std::ostream &out) const{
+    double total = 0.0;
+    out << "post-processing passes (GPU time):\n" << std::fixed << std::setprecision(3);
+    for(const Pass *pass : passes){
+        out << "  " << std::setw(22) << std::left << pass->file << std::right
+            << std::setw(5) << pass->width << "x" << std::setw(4) << std::left << pass->height << std::right;
+        if(!pass->enabled){
+            out << "  disabled\n";
+            continue;
+        }
+        out << "  avg " << pass->timer.average_ms() << " ms  last " << pass->timer.last_ms() << " ms\n";
+        total += pass->timer.average_ms();
+    }
+    out << "  total " << total << " ms, budget " << budget_ms << " ms\n";
+}
@@ -0,0 +1,64 @@
+#ifndef POSTPROCESS_HPP
+#define POSTPROCESS_HPP
+#include <glad/glad.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+#include "gpu_timer.hpp"
+#include "options.hpp"
+
+
+// a chain of fullscreen shader passes described by a preset, either a file
+// on disk or a name known to shader_source. Each line
+//   pass <fragment shader> <source|output> [feedback] [optional] [name=v1,v2..]
+// adds a pass rendered at the chip 8 resolution or the window resolution.
+// Feedback passes ping-pong between two targets and can read their own
+// previous output, which is how phosphor persistence hides XOR flicker.
+// Optional passes are dropped from the end when the chain exceeds its GPU
+// budget. The last pass draws to the window or a caller's framebuffer.
+class PostChain {
+    public:
+        ~PostChain();
+        bool load(const char *preset_path, unsigned int vao);
+        void set_budget(double ms) { budget_ms = ms; }
+        void reload(const std::vector<std::string> &changed);  // rebuild passes using these files
+        // draws into target, the window's framebuffer unless given
+        void render(unsigned int source, int source_w, int source_h, int output_w, int output_h, unsigned int target = 0);
+        void report(std::ostream &out) const;   // per pass GPU timings
+        void set_frame_stats(FrameStats *stats);    // feed pass timings into stats
+
+    private:
+        struct Uniform {
+            std::string name;
+            std::vector<float> value;           // one to four components
+        };
+        struct Pass {
+            std::string file;
+            Shader *shader{};
+            bool at_output{};                   // window resolution, else chip 8 resolution
+            bool feedback{};                    // keeps its previous output
+            bool optional{};                    // may be dropped to meet the budget
+            bool enabled{true};
+            std::vector<Uniform> uniforms;
+            unsigned int fbo[2]{};
+            unsigned int tex[2]{};
+            int current{};                      // target written this frame
+            int width{}, height{};
+            GpuTimer timer;
+        };
+
+        bool parse(const std::string &text, const char *preset_name);
+        void resize(Pass &pass, int w, int h);
+        void enforce_budget();
+
+        std::vector<Pass*> passes;
+        unsigned int vao{};
+        double budget_ms{DEFAULT_GPU_BUDGET_MS};
+        unsigned long frames{};
+        std::chrono::steady_clock::time_point last_frame;
+};
+
+#endif
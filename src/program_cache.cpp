@@ -0,0 +1,176 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <sys/stat.h>
+
+#include "program_cache.hpp"
+#include "gl_util.hpp"
+
+// tokens from GL 4.1 / ARB_get_program_binary and KHR_parallel_shader_compile
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#define CACHE_MAGIC 0x42503843u     // "C8PB"
+#define CACHE_MAX_BINARY (16u << 20)  // larger lengths are taken as corrupt
+
+typedef void (APIENTRYP PFN_GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFN_ProgramBinary)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFN_ProgramParameteri)(GLuint program, GLenum pname, GLint value);
+
+static PFN_GetProgramBinary getProgramBinary;
+static PFN_ProgramBinary programBinary;
+static PFN_ProgramParameteri programParameteri;
+static bool parallelCompile;
+static std::string cacheDirectory;
+static uint64_t driverHash;
+
+// 64-bit FNV-1a, continued from a previous hash
+static uint64_t fnv1a(uint64_t hash, const char *data, size_t size){
+    for(size_t i = 0; i < size; i++){
+        hash ^= (uint8_t)data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static uint64_t fnv1a(uint64_t hash, const std::string &text){
+    // include the terminator so "ab"+"c" and "a"+"bc" differ
+    return fnv1a(hash, text.c_str(), text.size() + 1);
+}
+
+static std::string cache_path(uint64_t key){
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return cacheDirectory + "/" + name;
+}
+
+void program_cache_init(GLADloadproc load, const char *directory){
+    parallelCompile = gl_has_extension("GL_KHR_parallel_shader_compile") ||
+                      gl_has_extension("GL_ARB_parallel_shader_compile");
+
+    int formats = 0;
+    if(GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1) ||
+       gl_has_extension("GL_ARB_get_program_binary")){
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    if(formats <= 0){
+        return;
+    }
+    getProgramBinary = (PFN_GetProgramBinary)load("glGetProgramBinary");
+    programBinary = (PFN_ProgramBinary)load("glProgramBinary");
+    programParameteri = (PFN_ProgramParameteri)load("glProgramParameteri");
+    if(!getProgramBinary || !programBinary || !programParameteri){
+        getProgramBinary = nullptr;
+        return;
+    }
+
+    // $XDG_CACHE_HOME/chip8-shaders, falling back to ~/.cache/chip8-shaders
+    if(directory){
+        cacheDirectory = directory;
+    }
+    else if(const char *xdg = std::getenv("XDG_CACHE_HOME")){
+        cacheDirectory = std::string(xdg) + "/chip8-shaders";
+    }
+    else if(const char *home = std::getenv("HOME")){
+        mkdir((std::string(home) + "/.cache").c_str(), 0755);
+        cacheDirectory = std::string(home) + "/.cache/chip8-shaders";
+    }
+    else{
+        cacheDirectory = ".shader-cache";
+    }
+    mkdir(cacheDirectory.c_str(), 0755);
+
+    // binaries are only valid for the driver that produced them
+    driverHash = 0xCBF29CE484222325ull;
+    GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+    for(GLenum name : strings){
+        const char *value = (const char*)glGetString(name);
+        driverHash = fnv1a(driverHash, value ? value : "");
+    }
+}
+
+uint64_t program_cache_key(const std::string &vertex, const std::string &fragment){
+    return fnv1a(fnv1a(driverHash, vertex), fragment);
+}
+
+bool program_cache_load(unsigned int program, uint64_t key){
+    if(!getProgramBinary){
+        return false;
+    }
+    std::ifstream file(cache_path(key), std::ios::binary);
+    uint32_t header[3];     // magic, binary format, length
+    if(!file.read((char*)header, sizeof(header)) || header[0] != CACHE_MAGIC){
+        return false;
+    }
+    // the binary fills the rest of the file; a truncated or corrupt length is a miss
+    std::streamoff start = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff remaining = file.tellg() - start;
+    if(header[2] == 0 || header[2] > CACHE_MAX_BINARY || remaining != (std::streamoff)header[2]){
+        return false;
+    }
+    file.seekg(start);
+    std::vector<char> binary(header[2]);
+    if(!file.read(binary.data(), binary.size())){
+        return false;
+    }
+
+    // a driver may still reject a binary, in which case we compile normally
+    programBinary(program, header[1], binary.data(), (GLsizei)binary.size());
+    int linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked != 0;
+}
+
+void program_cache_prepare(unsigned int program){
+    if(getProgramBinary){
+        programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+void program_cache_store(unsigned int program, uint64_t key){
+    if(!getProgramBinary){
+        return;
+    }
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0){
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    getProgramBinary(program, length, &length, &format, binary.data());
+
+    // write to a temporary name first so a crash never leaves half a binary
+    std::string path = cache_path(key);
+    std::string temp = path + ".tmp";
+    std::ofstream file(temp, std::ios::binary);
+    uint32_t header[3] = { CACHE_MAGIC, format, (uint32_t)length };
+    file.write((const char*)header, sizeof(header));
+    file.write(binary.data(), length);
+    file.close();
+    if(!file || std::rename(temp.c_str(), path.c_str()) != 0){
+        std::remove(temp.c_str());
+    }
+}
+
+bool program_link_done(unsigned int program){
+    if(!parallelCompile){
+        return true;
+    }
+    int done = 0;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+    return done != 0;
+}
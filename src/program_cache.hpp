@@ -0,0 +1,23 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+
+// on-disk cache of linked shader programs. Binaries are stored with
+// glGetProgramBinary under a key made from the shader sources and the
+// driver strings, so a driver update or an edited shader misses the cache.
+// glGetProgramBinary is GL 4.1 / ARB_get_program_binary and is not in the
+// 3.3 loader, so the entry points are fetched in program_cache_init.
+
+void     program_cache_init(GLADloadproc load, const char *directory = nullptr);
+uint64_t program_cache_key(const std::string &vertex, const std::string &fragment);
+bool     program_cache_load(unsigned int program, uint64_t key);   // true if linked from cache
+void     program_cache_prepare(unsigned int program);              // call before glLinkProgram
+void     program_cache_store(unsigned int program, uint64_t key);
+
+// true once a program started with glLinkProgram can be queried without
+// blocking; always true without KHR/ARB_parallel_shader_compile
+bool     program_link_done(unsigned int program);
+
+#endif
@@ -0,0 +1,33 @@
+#include "renderer.hpp"
+#include "soft_renderer.hpp"
+#ifndef CHIP8_NO_GL
+#include "gl_renderer.hpp"
+#include "offscreen_renderer.hpp"
+#endif
+
+bool NullRenderer::init(const Options &options, StartupTimer&){
+    limit = options.frames ? 0 : WINDOWLESS_FRAMES;
+    return true;
+}
+
+void NullRenderer::report(std::ostream &out) const{
+    out << "null renderer: " << uploads << " screen changes" << (halted ? ", stopped where the ROM halts" : "") << "\n";
+}
+
+Renderer* make_renderer(const std::string &name){
+#ifndef CHIP8_NO_GL
+    if(name == "gl"){
+        return new GlRenderer();
+    }
+    if(name == "offscreen"){
+        return new OffscreenRenderer();
+    }
+#endif
+    if(name == "soft"){
+        return new SoftRenderer();
+    }
+    if(name == "null"){
+        return new NullRenderer();
+    }
+    return nullptr;
+}
@@ -0,0 +1,54 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+#include <iostream>
+#include <string>
+
+#include "chip8.hpp"
+#include "frame_stats.hpp"
+#include "latency.hpp"
+#include "memory_heat.hpp"
+#include "options.hpp"
+#include "startup_timer.hpp"
+
+#define WINDOWLESS_FRAMES 600           // null and offscreen stop here without --frames
+
+// presents chip 8 frames and feeds keys back. main drives one of these per
+// loop iteration: process_input, upload when the screen changed, draw, then
+// present.
+class Renderer {
+    public:
+        virtual ~Renderer() {}
+        virtual bool init(const Options &options, StartupTimer &startup) = 0;
+        virtual bool should_close() = 0;
+        virtual void process_input(Chip8 &chip8, LatencyTracker *latency) = 0;
+        virtual void upload(const Chip8 &chip8) = 0;    // the screen changed
+        virtual void draw() = 0;
+        virtual void present() = 0;
+        virtual void report(std::ostream &/*out*/) const {}
+        virtual void set_frame_stats(FrameStats */*stats*/) {}     // add the backend's own timings
+        virtual void set_memory_heat(MemoryHeat */*heat*/) {}      // show memory accesses, if the backend can
+};
+
+// renders nothing; measures the cost of emulation alone. With no window to
+// close it stops, unless --frames is given, once the ROM halts or after
+// WINDOWLESS_FRAMES
+class NullRenderer : public Renderer {
+    public:
+        bool init(const Options &options, StartupTimer&) override;
+        bool should_close() override { return limit && (halted || presents >= limit); }
+        void process_input(Chip8 &chip8, LatencyTracker*) override { halted = chip8.halted(); }
+        void upload(const Chip8&) override { uploads++; }
+        void draw() override {}
+        void present() override { presents++; }
+        void report(std::ostream &out) const override;
+
+    private:
+        unsigned long uploads{};
+        long presents{}, limit{};       // 0 with --frames, which main counts exactly
+        bool halted{};
+};
+
+// backend by name: "gl", "offscreen", "soft" or "null". nullptr if unknown or not built
+Renderer* make_renderer(const std::string &name);
+
+#endif
@@ -0,0 +1,307 @@
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "rom_gen.hpp"
+
+const char *const rom_kinds[] = { "draw", "branch", "calls", "memory", "selfmod", nullptr };
+
+// a memory image filled from 0x200 with code and from ROMGEN_DATA with data
+struct Program {
+    uint8_t  image[4096]{};
+    uint16_t pc{0x200};
+    uint16_t data{ROMGEN_DATA};
+    bool     overflow{};
+
+    void op(uint16_t opcode){
+        if(pc >= ROMGEN_DATA){
+            overflow = true;
+            return;
+        }
+        image[pc] = opcode >> 8;
+        image[pc + 1] = opcode & 0xFF;
+        pc += 2;
+    }
+    uint16_t reserve(int n){
+        uint16_t address = data;
+        if(data + n > 4096){
+            overflow = true;
+            return ROMGEN_DATA;
+        }
+        data += n;
+        return address;
+    }
+};
+
+// every workload repeats its body inner * outer times, VE and VD count the
+// loops, then the program stops on a jump to itself
+struct Loops {
+    uint16_t outer, inner;
+};
+
+static Loops begin_loops(Program &p){
+    Loops loops;
+    p.op(0x6D00);
+    loops.outer = p.pc;
+    p.op(0x6E00);
+    loops.inner = p.pc;
+    return loops;
+}
+
+static uint16_t end_loops(Program &p, const Loops &loops, int inner, int outer){
+    p.op(0x7E01);
+    p.op(0x3E00 | inner);
+    p.op(0x1000 | loops.inner);
+    p.op(0x7D01);
+    p.op(0x3D00 | outer);
+    p.op(0x1000 | loops.outer);
+    uint16_t halt = p.pc;
+    p.op(0x1000 | halt);
+    return halt;
+}
+
+static bool out_of_range(const char *what, int value, int low, int high){
+    if(value >= low && value <= high){
+        return false;
+    }
+    std::cerr << "ERROR::ROMGEN::BAD_PARAMETER " << what << " " << value
+              << " (expected " << low << " to " << high << ")" << std::endl;
+    return true;
+}
+
+bool generate_rom(const RomSpec &spec, GeneratedRom &out){
+    if(out_of_range("iterations", spec.iterations, 1, ROMGEN_MAX_ITERATIONS)){
+        return false;
+    }
+    int outer = (spec.iterations + 254) / 255;
+    int inner = (spec.iterations + outer - 1) / outer;
+    unsigned long total = (unsigned long)inner * outer;
+    std::mt19937 random(spec.seed);
+
+    Program p;
+    unsigned long setup = 0;            // instructions before the loops
+    unsigned long body = 0;             // instructions run per iteration
+    uint16_t halt = 0;
+    // final state, applied over the loaded ROM below
+    uint8_t registers[16]{};
+    uint16_t index = 0;
+    uint16_t stack[16]{};
+    std::vector<std::pair<uint16_t, uint8_t>> stores;   // memory the program writes
+    std::vector<std::pair<uint16_t, int>> sprites;      // address and screen slot of drawn sprites
+
+    if(spec.kind == "draw"){
+        // a grid of 8x16 cells, so sprites never overlap and VF stays 0
+        if(out_of_range("count", spec.count, 1, 16) || out_of_range("size", spec.size, 1, 15)){
+            return false;
+        }
+        Loops loops = begin_loops(p);
+        p.op(0x00E0);
+        for(int k = 0; k < spec.count; k++){
+            uint16_t sprite = p.reserve(spec.size);
+            for(int row = 0; row < spec.size; row++){
+                p.image[sprite + row] = random() & 0xFF;
+            }
+            p.op(0xA000 | sprite);
+            p.op(0x6000 | (k % 8) * 8);
+            p.op(0x6100 | (k / 8) * 16);
+            p.op(0xD010 | spec.size);
+            sprites.push_back(std::make_pair(sprite, k));
+        }
+        body = 1 + 4 * spec.count;
+        halt = end_loops(p, loops, inner, outer);
+        int last = spec.count - 1;
+        registers[0] = (last % 8) * 8;
+        registers[1] = (last / 8) * 16;
+        index = sprites.back().first;
+    }
+    else if(spec.kind == "branch"){
+        // V4 == V5 == 5A, V7 == 33; V6 counts the 7XNN that were not skipped
+        if(out_of_range("count", spec.count, 1, 600)){
+            return false;
+        }
+        static const uint16_t skips[8][2] = {
+            { 0x345A, 1 }, { 0x3455, 0 },   // 3XNN
+            { 0x4455, 1 }, { 0x445A, 0 },   // 4XNN
+            { 0x5450, 1 }, { 0x5470, 0 },   // 5XY0
+            { 0x9470, 1 }, { 0x9450, 0 },   // 9XY0
+        };
+        p.op(0x645A);
+        p.op(0x655A);
+        p.op(0x6733);
+        setup = 3;
+        Loops loops = begin_loops(p);
+        unsigned long counted = 0;
+        for(int k = 0; k < spec.count; k++){
+            const uint16_t *skip = skips[random() % 8];
+            p.op(skip[0]);
+            p.op(0x7601);
+            body += skip[1] ? 1 : 2;
+            counted += skip[1] ? 0 : 1;
+        }
+        halt = end_loops(p, loops, inner, outer);
+        registers[4] = 0x5A;
+        registers[5] = 0x5A;
+        registers[7] = 0x33;
+        registers[6] = (counted * total) & 0xFF;
+    }
+    else if(spec.kind == "calls"){
+        // level l calls level l + 1 count times; the leaves bump V3
+        if(out_of_range("size", spec.size, 1, 16) || out_of_range("count", spec.count, 1, 16)){
+            return false;
+        }
+        // capped over all iterations, each one walks the whole tree
+        unsigned long leaves = 1;
+        for(int level = 1; level < spec.size; level++){
+            leaves *= spec.count;
+            if(leaves * total > 1000000){
+                std::cerr << "ERROR::ROMGEN::BAD_PARAMETER calls tree reaches over 1000000 leaves in "
+                          << total << " iterations" << std::endl;
+                return false;
+            }
+        }
+        // functions first, jumped over, so the loop knows where they are
+        std::vector<uint16_t> functions(spec.size);
+        uint16_t address = 0x202;
+        for(int level = 0; level < spec.size; level++){
+            functions[level] = address;
+            address += level == spec.size - 1 ? 4 : 2 * (spec.count + 1);
+        }
+        p.op(0x1000 | address);
+        for(int level = 0; level < spec.size; level++){
+            if(level == spec.size - 1){
+                p.op(0x7301);
+            }
+            else{
+                for(int call = 0; call < spec.count; call++){
+                    p.op(0x2000 | functions[level + 1]);
+                }
+            }
+            p.op(0x00EE);
+        }
+        setup = 1;
+        Loops loops = begin_loops(p);
+        uint16_t call = p.pc;
+        p.op(0x2000 | functions[0]);
+        unsigned long nodes = 1;
+        body = 1;
+        for(int level = 0; level < spec.size - 1; level++){
+            body += nodes * (spec.count + 1);
+            nodes *= spec.count;
+        }
+        body += leaves * 2;
+        halt = end_loops(p, loops, inner, outer);
+        registers[3] = (leaves * total) & 0xFF;
+        // return addresses of the last call made at each depth
+        stack[0] = call + 2;
+        for(int level = 1; level < spec.size; level++){
+            stack[level] = functions[level - 1] + 2 * spec.count;
+        }
+    }
+    else if(spec.kind == "memory"){
+        // V0 to V(size - 1) hold random bytes, V0 counts iterations
+        if(out_of_range("size", spec.size, 1, 13) || out_of_range("count", spec.count, 1, 63)){
+            return false;
+        }
+        int last = spec.size - 1;
+        for(int r = 0; r < spec.size; r++){
+            registers[r] = random() & 0xFF;
+            p.op(0x6000 | r << 8 | registers[r]);
+        }
+        setup = spec.size;
+        std::vector<uint16_t> buffers;
+        for(int k = 0; k < spec.count; k++){
+            buffers.push_back(p.reserve(16));
+        }
+        uint16_t bcd = p.reserve(3);
+        Loops loops = begin_loops(p);
+        p.op(0x7001);
+        for(uint16_t buffer : buffers){
+            p.op(0xA000 | buffer);
+            p.op(0xF055 | last << 8);
+        }
+        p.op(0xA000 | buffers[0]);
+        p.op(0xF065 | last << 8);
+        p.op(0xA000 | bcd);
+        p.op(0xF033);
+        body = 1 + 2 * spec.count + 4;
+        halt = end_loops(p, loops, inner, outer);
+        registers[0] += total & 0xFF;
+        for(uint16_t buffer : buffers){
+            for(int r = 0; r <= last; r++){
+                stores.push_back(std::make_pair(buffer + r, registers[r]));
+            }
+        }
+        stores.push_back(std::make_pair(bcd, registers[0] / 100));
+        stores.push_back(std::make_pair(bcd + 1, registers[0] / 10 % 10));
+        stores.push_back(std::make_pair(bcd + 2, registers[0] % 10));
+        index = bcd;
+    }
+    else if(spec.kind == "selfmod"){
+        // V0 counts iterations and is stored into the NN of each 7XNN, so
+        // V1 to Vcount each end as the sum of 1 to the iteration count
+        if(out_of_range("count", spec.count, 1, 12)){
+            return false;
+        }
+        Loops loops = begin_loops(p);
+        p.op(0x7001);
+        std::vector<uint16_t> patched;
+        for(int k = 1; k <= spec.count; k++){
+            uint16_t site = p.pc + 4;
+            p.op(0xA000 | (site + 1));
+            p.op(0xF055);
+            p.op(0x7000 | k << 8);
+            patched.push_back(site + 1);
+        }
+        body = 1 + 3 * spec.count;
+        halt = end_loops(p, loops, inner, outer);
+        registers[0] = total & 0xFF;
+        for(int k = 1; k <= spec.count; k++){
+            registers[k] = (total * (total + 1) / 2) & 0xFF;
+        }
+        for(uint16_t address : patched){
+            stores.push_back(std::make_pair(address, registers[0]));
+        }
+        index = patched.back();
+    }
+    else{
+        std::cerr << "ERROR::ROMGEN::UNKNOWN_KIND " << spec.kind << std::endl;
+        return false;
+    }
+    if(p.overflow){
+        std::cerr << "ERROR::ROMGEN::TOO_LARGE " << spec.kind << " does not fit in memory with count "
+                  << spec.count << " and size " << spec.size << std::endl;
+        return false;
+    }
+
+    uint16_t end = p.data > ROMGEN_DATA ? p.data : p.pc;
+    out.rom.assign(p.image + 0x200, p.image + end);
+    out.iterations = total;
+    out.cycles = setup + (unsigned long)outer * (inner * (body + 3) + 3);
+
+    // loading goes through Chip8 so the font and layout match the interpreter
+    Chip8 loaded;
+    loaded.seed(spec.seed);
+    loaded.load(out.rom.data(), out.rom.size());
+    out.expected = loaded.state();
+    Chip8State &state = out.expected;
+    registers[0xD] = outer;
+    registers[0xE] = inner;
+    std::memcpy(state.registers, registers, sizeof(registers));
+    std::memcpy(state.stack, stack, sizeof(stack));
+    state.I = index;
+    state.pc = halt;
+    for(const auto &store : stores){
+        state.memory[store.first] = store.second;
+    }
+    for(const auto &sprite : sprites){
+        int x0 = sprite.second % 8 * 8, y0 = sprite.second / 8 * 16;
+        for(int row = 0; row < spec.size; row++){
+            for(int col = 0; col < 8; col++){
+                if(p.image[sprite.first + row] & (0x80 >> col)){
+                    state.screen[(y0 + row) * VIDEO_WIDTH + x0 + col] = 0xFFFFFFFF;
+                }
+            }
+        }
+    }
+    return true;
+}
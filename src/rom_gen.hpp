@@ -0,0 +1,42 @@
+#ifndef ROM_GEN_HPP
+#define ROM_GEN_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chip8.hpp"
+
+#define ROMGEN_DATA 0xC00               // sprites and buffers; code has to end below
+#define ROMGEN_MAX_ITERATIONS (255 * 255)
+
+// a stress workload: kind picks the instruction mix, count and size tune it
+//   draw     count sprites of size rows, redrawn on a cleared screen (DXYN, 00E0)
+//   branch   count skips (3XNN 4XNN 5XY0 9XY0), taken or not by seed, each guarding a 7XNN
+//   calls    a call tree size levels deep with count calls per level (2NNN, 00EE)
+//   memory   size registers stored to count buffers, read back and BCD'd (FX55 FX65 FX33)
+//   selfmod  count 7XNN instructions whose NN is rewritten each iteration (FX55 into code)
+struct RomSpec {
+    std::string kind;
+    int iterations{1000};               // of the mix, rounded up to a product of two bytes
+    int count{8};
+    int size{4};
+    uint32_t seed{1};                   // also the expected state's rng
+};
+
+// the program ends in a jump to itself. After cycles instructions pc is on
+// that jump and expected holds the machine state, worked out from the
+// program rather than by running it, so it checks any execution engine.
+struct GeneratedRom {
+    std::vector<uint8_t> rom;
+    unsigned long cycles{};
+    unsigned long iterations{};         // as run, after rounding
+    Chip8State expected;
+};
+
+extern const char *const rom_kinds[];   // nullptr terminated
+
+// false, with a message on stderr, for an unknown kind or parameters the
+// program would not fit in memory with
+bool generate_rom(const RomSpec &spec, GeneratedRom &out);
+
+#endif
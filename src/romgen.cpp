@@ -0,0 +1,123 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "chip8.hpp"
+#include "chip8_state.hpp"
+#include "rom_gen.hpp"
+
+// writes a synthetic stress ROM, and optionally the state it must end in
+// and a check of the interpreter against that state:
+//   chip8-romgen <kind> <rom> [--iterations n] [--count n] [--size n] [--seed n] [--expected <json>] [--check]
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <kind> <rom> [options]\n"
+              << "  kinds:";
+    for (const char *const *kind = rom_kinds; *kind; kind++)
+        std::cerr << " " << *kind;
+    std::cerr << " (see rom_gen.hpp)\n"
+              << "  --iterations <n>    times the mix runs before the ROM stops, up to " << ROMGEN_MAX_ITERATIONS << "\n"
+              << "  --count <n>         sprites, skips, calls per level, buffers or rewritten instructions\n"
+              << "  --size <n>          sprite rows, call depth or registers per store\n"
+              << "  --seed <n>          sprite bytes, skip mix and register values\n"
+              << "  --expected <json>   write the final state the ROM must reach\n"
+              << "  --check             run the interpreter and compare it with that state\n";
+    std::exit(EXIT_FAILURE);
+}
+
+static void write_hex(std::ostream &out, const uint8_t *bytes, size_t n)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < n; i++)
+        out << digits[bytes[i] >> 4] << digits[bytes[i] & 0xF];
+}
+
+static bool write_expected(const char *path, const GeneratedRom &generated)
+{
+    const Chip8State &state = generated.expected;
+    std::ofstream out(path);
+    out << "{\n  \"cycles\": " << generated.cycles
+        << ",\n  \"pc\": " << state.pc << ",\n  \"I\": " << state.I << ",\n  \"sp\": " << (int)state.sp
+        << ",\n  \"delay_timer\": " << (int)state.delay_timer << ",\n  \"sound_timer\": " << (int)state.sound_timer
+        << ",\n  \"registers\": [";
+    for (int i = 0; i < 16; i++)
+        out << (i ? ", " : "") << (int)state.registers[i];
+    out << "],\n  \"stack\": [";
+    for (int i = 0; i < 16; i++)
+        out << (i ? ", " : "") << state.stack[i];
+    out << "],\n  \"memory\": \"";
+    write_hex(out, state.memory, sizeof(state.memory));
+    // one bit per pixel, most significant first
+    uint8_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT / 8]{};
+    for (int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++)
+        if (state.screen[i])
+            pixels[i / 8] |= 0x80 >> (i % 8);
+    out << "\",\n  \"screen\": \"";
+    write_hex(out, pixels, sizeof(pixels));
+    out << "\"\n}\n";
+    return (bool)out;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+        usage(argv[0]);
+    RomSpec spec;
+    spec.kind = argv[1];
+    const char *romPath = argv[2];
+    const char *expectedPath = nullptr;
+    bool check = false;
+    for (int i = 3; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--iterations") == 0 && hasValue)
+            spec.iterations = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--count") == 0 && hasValue)
+            spec.count = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--size") == 0 && hasValue)
+            spec.size = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+            spec.seed = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        else if (std::strcmp(argv[i], "--expected") == 0 && hasValue)
+            expectedPath = argv[++i];
+        else if (std::strcmp(argv[i], "--check") == 0)
+            check = true;
+        else
+            usage(argv[0]);
+    }
+
+    GeneratedRom generated;
+    if (!generate_rom(spec, generated))
+        return EXIT_FAILURE;
+    std::ofstream rom(romPath, std::ios::binary);
+    rom.write((const char*)generated.rom.data(), generated.rom.size());
+    if (!rom)
+    {
+        std::cerr << "ERROR::ROMGEN::WRITE_FAILED " << romPath << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (expectedPath && !write_expected(expectedPath, generated))
+    {
+        std::cerr << "ERROR::ROMGEN::WRITE_FAILED " << expectedPath << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << spec.kind << ": " << generated.rom.size() << " bytes, " << generated.iterations
+              << " iterations, stops after " << generated.cycles << " instructions\n";
+
+    if (!check)
+        return 0;
+    Chip8 *chip8 = new Chip8();
+    chip8->seed(spec.seed);
+    chip8->load(generated.rom.data(), generated.rom.size());
+    for (unsigned long i = 0; i < generated.cycles; i++)
+        chip8->cycle();
+    Chip8State actual = chip8->state();
+    delete chip8;
+    bool same = same_state(generated.expected, actual);
+    if (!same)
+        print_differences(std::cout, generated.expected, actual, "expected", "got");
+    std::cout << (same ? "state matches\n" : "state differs\n");
+    return same ? 0 : EXIT_FAILURE;
+}
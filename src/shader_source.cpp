@@ -0,0 +1,44 @@
+#include <fstream>
+#include <sstream>
+
+#include "shader_source.hpp"
+#include "embedded_shaders.hpp"
+
+static std::string overrideDirectory;
+
+void shader_source_set_directory(const char *directory){
+    overrideDirectory = directory ? directory : "";
+    if(!overrideDirectory.empty() && overrideDirectory.back() != '/'){
+        overrideDirectory += '/';
+    }
+}
+
+const std::string &shader_source_directory(){
+    return overrideDirectory;
+}
+
+bool shader_source_read(const std::string &name, std::string &text){
+    if(!overrideDirectory.empty()){
+        std::ifstream file(overrideDirectory + name);
+        if(file.is_open()){
+            std::stringstream contents;
+            contents << file.rdbuf();
+            text = contents.str();
+            return true;
+        }
+    }
+    for(const EmbeddedFile &file : embedded_files){
+        if(name == file.name){
+            text = file.text;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string shader_source_name(const std::string &path){
+    if(!overrideDirectory.empty() && path.compare(0, overrideDirectory.size(), overrideDirectory) == 0){
+        return path.substr(overrideDirectory.size());
+    }
+    return path;
+}
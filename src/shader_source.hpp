@@ -0,0 +1,15 @@
+#ifndef SHADER_SOURCE_HPP
+#define SHADER_SOURCE_HPP
+#include <string>
+
+// shaders and presets are looked up by name relative to the shader
+// directory ("phosphor.frag", "presets/default.preset"). The copies embedded
+// at build time are used unless an override directory is set, in which case
+// files found there win.
+
+void shader_source_set_directory(const char *directory);   // nullptr: embedded only
+const std::string &shader_source_directory();               // empty if none
+bool shader_source_read(const std::string &name, std::string &text);
+std::string shader_source_name(const std::string &path);    // path on disk to name
+
+#endif
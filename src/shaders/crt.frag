@@ -0,0 +1,26 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D source;
+uniform vec2 originalSize;
+uniform float scanline;   // darkening between chip 8 rows, 0 to 1
+uniform float mask;       // strength of the RGB aperture mask, 0 to 1
+
+// runs on the already upscaled picture, so the chain looks right without it
+void main() {
+  vec3 c = texture(source, TexCoord).rgb;
+
+  // dim the edges of every chip 8 row like a beam scanning across
+  float dist = fract(TexCoord.y * originalSize.y) - 0.5f;
+  float beam = cos(dist * 3.14159265f);
+  c *= mix(1.0f, beam * beam, scanline);
+
+  // every third output column favours one primary colour
+  int column = int(mod(gl_FragCoord.x, 3.0f));
+  vec3 aperture = vec3(column == 0, column == 1, column == 2);
+  c *= mix(vec3(1.0f), 0.5f + aperture, mask);
+
+  FragColor = vec4(c, 1.0f);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 Color;
+
+uniform sampler2D heat;
+
+void main() {
+  // a dim floor keeps the panel visible while memory is quiet
+  FragColor = vec4(max(texture(heat, TexCoord).rgb, vec3(0.06)), Color.a);
+}
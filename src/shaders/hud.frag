@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 Color;
+
+uniform sampler2D atlas;
+
+void main() {
+  // glyph pixels are on or off; the solid cell draws panels and graph bars
+  FragColor = vec4(Color.rgb, Color.a * texture(atlas, TexCoord).r);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;         // pixels from the top left corner
+layout (location = 1) in vec2 aTexCoord;    // into the glyph atlas
+layout (location = 2) in vec4 aColor;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+uniform vec2 outputSize;
+
+void main()
+{
+	gl_Position = vec4(aPos.x / outputSize.x * 2.0f - 1.0f, 1.0f - aPos.y / outputSize.y * 2.0f, 0.0f, 1.0f);
+	TexCoord = aTexCoord;
+	Color = aColor;
+}
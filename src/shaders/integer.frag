@@ -0,0 +1,21 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D source;
+uniform vec2 sourceSize;
+uniform vec2 outputSize;
+uniform vec3 color;
+
+void main() {
+  // largest whole number scale that fits, centered with black borders
+  float scale = max(floor(min(outputSize.x / sourceSize.x, outputSize.y / sourceSize.y)), 1.0f);
+  vec2 offset = floor((outputSize - sourceSize * scale) * 0.5f);
+  vec2 pixel = floor((TexCoord * outputSize - offset) / scale);
+  if (any(lessThan(pixel, vec2(0.0f))) || any(greaterThanEqual(pixel, sourceSize))) {
+    FragColor = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    return;
+  }
+  FragColor = vec4(color * texelFetch(source, ivec2(pixel), 0).r, 1.0f);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D source;
+uniform sampler2D previous;
+uniform float decay;      // brightness kept after one 60 Hz frame
+uniform float frameTime;  // seconds since the previous frame
+
+void main() {
+  // lit pixels light up at once, dark ones fade out over a few frames so
+  // sprites erased and redrawn by XOR no longer flicker
+  float lit = texture(source, TexCoord).r;
+  float glow = texture(previous, TexCoord).r * pow(decay, frameTime * 60.0f);
+  FragColor = vec4(vec3(max(lit, glow)), 1.0f);
+}
@@ -1,9 +1,12 @@
 #version 330 core
 out vec4 FragColor;
 
+in vec2 TexCoord;
+
+uniform sampler2D source;
 uniform vec3 color;
 
 void main() {
-  FragColor = vec4(color, 1.0f);
-  // FragColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
-}
\ No newline at end of file
+  // source holds 1.0 for lit pixels and 0.0 for dark ones
+  FragColor = vec4(color * texture(source, TexCoord).r, 1.0f);
+}
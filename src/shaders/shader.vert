@@ -1,12 +1,15 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+out vec2 TexCoord;
+
+// passes that render into a texture flip vertically so every texture in
+// the chain keeps the chip 8 row order (row 0 at the top)
+uniform bool toTexture;
 
 void main()
 {
-	// gl_Position = projection * view * model * vec4(aPos, 1.0f);
-	gl_Position = model * vec4(aPos, 1.0f);
-}
\ No newline at end of file
+	gl_Position = vec4(aPos.x, toTexture ? -aPos.y : aPos.y, aPos.z, 1.0f);
+	TexCoord = aTexCoord;
+}
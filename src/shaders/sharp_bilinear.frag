@@ -0,0 +1,21 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D source;
+uniform vec2 sourceSize;
+uniform vec2 outputSize;
+uniform vec3 color;
+
+void main() {
+  // nearest neighbour inside each texel, bilinear only across the one
+  // output pixel wide seam between texels, so non integer scales stay sharp
+  vec2 texel = TexCoord * sourceSize;
+  vec2 scale = max(floor(outputSize / sourceSize), vec2(1.0f));
+  vec2 region = 0.5f - 0.5f / scale;
+  vec2 dist = fract(texel) - 0.5f;
+  vec2 f = (dist - clamp(dist, -region, region)) * scale + 0.5f;
+  vec2 coord = (floor(texel) + f) / sourceSize;
+  FragColor = vec4(color * texture(source, coord).r, 1.0f);
+}
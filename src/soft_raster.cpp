@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "soft_raster.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SOFT_RASTER_X86
+#include <immintrin.h>
+#endif
+
+#define EXPAND_SLACK 8      // pixels a wide store may run past the end of a row
+
+// glow = max(lit, glow * keep / 256), true if any pixel is still fading
+static bool decay_scalar(uint8_t *glow, const uint8_t *lit, int n, int keep){
+    bool fading = false;
+    for(int i = 0; i < n; i++){
+        uint8_t faded = (uint8_t)((glow[i] * keep) >> 8);
+        glow[i] = std::max(lit[i], faded);
+        fading |= glow[i] != lit[i];
+    }
+    return fading;
+}
+
+static void expand_scalar(uint32_t *dst, const uint32_t *src, int n, int scale){
+    for(int x = 0; x < n; x++){
+        for(int k = 0; k < scale; k++){
+            *dst++ = src[x];
+        }
+    }
+}
+
+#ifdef SOFT_RASTER_X86
+__attribute__((target("sse2")))
+static bool decay_sse2(uint8_t *glow, const uint8_t *lit, int n, int keep){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i factor = _mm_set1_epi16((short)keep);
+    __m128i changed = zero;
+    int i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m128i g = _mm_loadu_si128((const __m128i*)(glow + i));
+        __m128i l = _mm_loadu_si128((const __m128i*)(lit + i));
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(g, zero), factor), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(g, zero), factor), 8);
+        __m128i v = _mm_max_epu8(l, _mm_packus_epi16(lo, hi));
+        _mm_storeu_si128((__m128i*)(glow + i), v);
+        changed = _mm_or_si128(changed, _mm_xor_si128(v, l));
+    }
+    bool fading = _mm_movemask_epi8(_mm_cmpeq_epi8(changed, zero)) != 0xFFFF;
+    return decay_scalar(glow + i, lit + i, n - i, keep) || fading;
+}
+
+// every pixel is written with whole vector stores; the part of the last store
+// that runs past it is overwritten by the next pixel
+__attribute__((target("sse2")))
+static void expand_sse2(uint32_t *dst, const uint32_t *src, int n, int scale){
+    for(int x = 0; x < n; x++, dst += scale){
+        __m128i v = _mm_set1_epi32((int)src[x]);
+        for(int k = 0; k < scale; k += 4){
+            _mm_storeu_si128((__m128i*)(dst + k), v);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static bool decay_avx2(uint8_t *glow, const uint8_t *lit, int n, int keep){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i factor = _mm256_set1_epi16((short)keep);
+    __m256i changed = zero;
+    int i = 0;
+    for(; i + 32 <= n; i += 32){
+        __m256i g = _mm256_loadu_si256((const __m256i*)(glow + i));
+        __m256i l = _mm256_loadu_si256((const __m256i*)(lit + i));
+        // unpack and pack both work per 128 bit lane, so the order survives
+        __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(g, zero), factor), 8);
+        __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(g, zero), factor), 8);
+        __m256i v = _mm256_max_epu8(l, _mm256_packus_epi16(lo, hi));
+        _mm256_storeu_si256((__m256i*)(glow + i), v);
+        changed = _mm256_or_si256(changed, _mm256_xor_si256(v, l));
+    }
+    bool fading = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(changed, zero)) != 0xFFFFFFFFu;
+    return decay_sse2(glow + i, lit + i, n - i, keep) || fading;
+}
+
+__attribute__((target("avx2")))
+static void expand_avx2(uint32_t *dst, const uint32_t *src, int n, int scale){
+    for(int x = 0; x < n; x++, dst += scale){
+        __m256i v = _mm256_set1_epi32((int)src[x]);
+        for(int k = 0; k < scale; k += 8){
+            _mm256_storeu_si256((__m256i*)(dst + k), v);
+        }
+    }
+}
+#endif
+
+bool SoftRaster::init(int w, int h, int s){
+    if(w <= 0 || h <= 0 || s < 1 || s > SOFT_RASTER_MAX_SCALE){
+        return false;
+    }
+    source_w = w;
+    source_h = h;
+    scale = s;
+    glow.assign((size_t)w * h, 0);
+    colors.assign(w, 0);
+    out.assign((size_t)width() * height() + EXPAND_SLACK, 0);
+    set_palette(SOFT_PALETTE_OFF, SOFT_PALETTE_ON);
+
+    // narrow scales gain nothing from wide stores
+    decay_kernel = decay_scalar;
+    expand_kernel = expand_scalar;
+    kernel_name = "scalar";
+#ifdef SOFT_RASTER_X86
+    if(__builtin_cpu_supports("avx2")){
+        decay_kernel = decay_avx2;
+        kernel_name = "avx2";
+        if(scale >= 8){
+            expand_kernel = expand_avx2;
+        }
+        else if(scale >= 4){
+            expand_kernel = expand_sse2;
+        }
+    }
+    else if(__builtin_cpu_supports("sse2")){
+        decay_kernel = decay_sse2;
+        kernel_name = "sse2";
+        if(scale >= 4){
+            expand_kernel = expand_sse2;
+        }
+    }
+#endif
+    return true;
+}
+
+void SoftRaster::set_palette(uint32_t off, uint32_t on){
+    for(int i = 0; i < 256; i++){
+        uint32_t color = 0;
+        for(int shift = 0; shift < 32; shift += 8){
+            int a = (off >> shift) & 0xFF;
+            int b = (on >> shift) & 0xFF;
+            color |= (uint32_t)((a * (255 - i) + b * i + 127) / 255) << shift;
+        }
+        palette[i] = color;
+    }
+}
+
+bool SoftRaster::render(const uint8_t *screen, float frame_time){
+    const uint8_t *lit = screen;
+    bool fading = false;
+    if(persistence > 0){
+        // brightness kept over frame_time, in 1/256ths
+        float keep = std::pow(persistence, frame_time * 60.0f);
+        int factor = std::min(255, std::max(0, (int)(keep * 256.0f)));
+        fading = decay_kernel(glow.data(), screen, source_w * source_h, factor);
+        lit = glow.data();
+    }
+
+    // expand each source row once, then copy it down for the remaining rows
+    const int w = width();
+    for(int y = 0; y < source_h; y++){
+        const uint8_t *row = lit + y * source_w;
+        for(int x = 0; x < source_w; x++){
+            colors[x] = palette[row[x]];
+        }
+        uint32_t *dst = out.data() + (size_t)y * scale * w;
+        expand_kernel(dst, colors.data(), source_w, scale);
+        for(int r = 1; r < scale; r++){
+            std::memcpy(dst + (size_t)r * w, dst, w * sizeof(uint32_t));
+        }
+    }
+    return fading;
+}
+
+bool parse_color(const char *text, uint32_t &color){
+    if(*text == '#'){
+        text++;
+    }
+    char *end;
+    unsigned long rgb = std::strtoul(text, &end, 16);
+    if(std::strlen(text) != 6 || *end){
+        return false;
+    }
+    color = 0xFF000000u | ((rgb & 0xFF) << 16) | (rgb & 0xFF00) | ((rgb >> 16) & 0xFF);
+    return true;
+}
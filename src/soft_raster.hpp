@@ -0,0 +1,45 @@
+#ifndef SOFT_RASTER_HPP
+#define SOFT_RASTER_HPP
+#include <cstdint>
+#include <vector>
+
+#define SOFT_RASTER_MAX_SCALE 64
+#define SOFT_PALETTE_OFF 0xFF000000u     // 0xAABBGGRR, RGBA bytes in memory
+#define SOFT_PALETTE_ON  0xFFFFFFFFu
+
+// expands a one byte per pixel chip 8 screen to RGBA at an integer scale on
+// the CPU. Phosphor persistence works like phosphor.frag: lit pixels light at
+// once and dark ones fade by decay per 60 Hz frame. Intensities are mapped
+// through a palette lerping from the off to the on color. The per pixel work
+// runs on SSE2 or AVX2 kernels picked at runtime.
+class SoftRaster {
+    public:
+        bool init(int source_w, int source_h, int scale);
+        void set_palette(uint32_t off, uint32_t on);
+        void set_persistence(float decay) { persistence = decay; }  // 0 turns it off
+        bool render(const uint8_t *screen, float frame_time);      // true while pixels still fade
+
+        const uint32_t* pixels() const { return out.data(); }
+        int width() const { return source_w * scale; }
+        int height() const { return source_h * scale; }
+        const char* kernel() const { return kernel_name; }
+
+    private:
+        typedef bool (*DecayKernel)(uint8_t *glow, const uint8_t *lit, int n, int keep);
+        typedef void (*ExpandKernel)(uint32_t *dst, const uint32_t *src, int n, int scale);
+
+        int source_w{}, source_h{}, scale{1};
+        float persistence{};
+        uint32_t palette[256];
+        std::vector<uint8_t> glow;          // phosphor intensity at the source resolution
+        std::vector<uint32_t> colors;       // one source row through the palette
+        std::vector<uint32_t> out;          // width() * height(), plus slack for wide stores
+        DecayKernel decay_kernel{};
+        ExpandKernel expand_kernel{};
+        const char *kernel_name{};
+};
+
+// "RRGGBB" as written in CSS to the 0xAABBGGRR layout; false if malformed
+bool parse_color(const char *text, uint32_t &color);
+
+#endif
@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "soft_renderer.hpp"
+
+// same layout as processInput:
+// 1 2 3 4
+// Q W E R
+// A S D F
+// Z X C V
+static int key_index(char c){
+    static const char layout[] = "1234qwerasdfzxcv";
+    if(c >= 'A' && c <= 'Z'){
+        c += 'a' - 'A';
+    }
+    const char *found = std::strchr(layout, c);
+    return c && found ? (int)(found - layout) : -1;
+}
+
+static void append_color(std::string &text, const char *prefix, uint32_t color){
+    char code[24];
+    std::snprintf(code, sizeof(code), "\x1b[%s;2;%u;%u;%um", prefix,
+                  color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF);
+    text += code;
+}
+
+SoftRenderer::~SoftRenderer(){
+    if(terminal){
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    }
+    // show the cursor again, reports follow below the last frame
+    std::fputs("\x1b[0m\x1b[?25h", stdout);
+    std::fflush(stdout);
+}
+
+bool SoftRenderer::init(const Options &options, StartupTimer &startup){
+    if(!rasterizer.init(VIDEO_WIDTH, VIDEO_HEIGHT, options.scale)){
+        std::cerr << "Scale must be between 1 and " << SOFT_RASTER_MAX_SCALE << "\n";
+        return false;
+    }
+    rasterizer.set_palette(options.palette_off, options.palette_on);
+    rasterizer.set_persistence(options.phosphor);
+    last_draw = clock::now();
+
+    // raw, non-blocking keyboard; ctrl-c arrives as a byte so the terminal is restored
+    if(isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0){
+        struct termios raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        terminal = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+    }
+    // clear the screen and hide the cursor
+    std::fputs("\x1b[2J\x1b[?25l", stdout);
+    startup.mark("terminal");
+    return true;
+}
+
+void SoftRenderer::process_input(Chip8 &chip8, LatencyTracker *latency){
+    if(!terminal){
+        return;
+    }
+    clock::time_point now = clock::now();
+    uint8_t previous[16];
+    std::memcpy(previous, chip8.key, sizeof(previous));
+
+    char input[64];
+    ssize_t length = read(STDIN_FILENO, input, sizeof(input));
+    for(ssize_t i = 0; i < length; i++){
+        char c = input[i];
+        if(c == 0x03 || (c == 0x1b && i + 1 == length)){
+            // ctrl-c, or escape on its own
+            quit = true;
+        }
+        else if(c == 0x1b){
+            // skip escape sequences such as arrow keys: ESC [ ... final byte
+            i++;
+            if(input[i] == '[' || input[i] == 'O'){
+                while(i + 1 < length && !(input[i + 1] >= '@' && input[i + 1] <= '~')){
+                    i++;
+                }
+                i++;
+            }
+        }
+        else{
+            int k = key_index(c);
+            if(k >= 0){
+                pressed[k] = now;
+            }
+        }
+    }
+
+    for(int k = 0; k < 16; k++){
+        chip8.key[k] = now - pressed[k] < std::chrono::milliseconds(SOFT_KEY_HOLD_MS);
+    }
+
+    if(latency && std::memcmp(previous, chip8.key, sizeof(previous)) != 0){
+        latency->input_event(now);
+    }
+}
+
+void SoftRenderer::upload(const Chip8 &chip8){
+    chip8.expand_screen(screen);
+    dirty = true;
+}
+
+void SoftRenderer::draw(){
+    // redraw while the screen changes or the phosphor fades, at the terminal's pace
+    clock::time_point now = clock::now();
+    double elapsed = std::chrono::duration<double, std::milli>(now - last_draw).count();
+    if((!dirty && !fading) || elapsed < SOFT_FRAME_MS){
+        return;
+    }
+    dirty = false;
+    last_draw = now;
+    fading = rasterizer.render(screen, (float)(elapsed / 1000.0));
+    raster_ms += std::chrono::duration<double, std::milli>(clock::now() - now).count();
+
+    // upper half block: foreground is the top pixel, background the bottom one,
+    // colors are only emitted when they change
+    const uint32_t *pixels = rasterizer.pixels();
+    const int width = rasterizer.width();
+    const int height = rasterizer.height();
+    text = "\x1b[H";
+    for(int y = 0; y < height; y += 2){
+        uint32_t fg = 0, bg = 0;
+        bool first = true;
+        for(int x = 0; x < width; x++){
+            uint32_t top = pixels[y * width + x];
+            uint32_t bottom = y + 1 < height ? pixels[(y + 1) * width + x] : top;
+            if(first || top != fg){
+                append_color(text, "38", top);
+                fg = top;
+            }
+            if(first || bottom != bg){
+                append_color(text, "48", bottom);
+                bg = bottom;
+            }
+            first = false;
+            text += "\xe2\x96\x80";
+        }
+        text += "\x1b[0m\r\n";
+    }
+    shown = false;
+    draws++;
+}
+
+void SoftRenderer::present(){
+    if(shown){
+        return;
+    }
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fflush(stdout);
+    bytes += text.size();
+    shown = true;
+}
+
+void SoftRenderer::report(std::ostream &out) const{
+    out << "soft renderer (" << rasterizer.kernel() << ", " << rasterizer.width() << "x" << rasterizer.height() << "): "
+        << draws << " frames drawn";
+    if(draws){
+        out << ", avg " << raster_ms / draws << " ms raster";
+    }
+    out << ", " << bytes << " bytes written to the terminal\n";
+}
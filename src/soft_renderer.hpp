@@ -0,0 +1,52 @@
+#ifndef SOFT_RENDERER_HPP
+#define SOFT_RENDERER_HPP
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <termios.h>
+
+#include "renderer.hpp"
+#include "soft_raster.hpp"
+
+#define SOFT_KEY_HOLD_MS 150        // terminals report presses only, keys stay down this long
+#define SOFT_FRAME_MS    (1000.0 / 60.0)
+
+// renders on the CPU with SoftRaster and shows the result in the terminal,
+// two pixels per character cell using the upper half block, at most 60 times
+// a second. Needs no GL at all.
+// Keys are read from stdin in raw mode; since a terminal never reports a
+// release, a key counts as held until SOFT_KEY_HOLD_MS after its last repeat.
+class SoftRenderer : public Renderer {
+    public:
+        ~SoftRenderer();
+        bool init(const Options &options, StartupTimer &startup) override;
+        bool should_close() override { return quit; }
+        void process_input(Chip8 &chip8, LatencyTracker *latency) override;
+        void upload(const Chip8 &chip8) override;
+        void draw() override;
+        void present() override;
+        void report(std::ostream &out) const override;
+
+        const SoftRaster& raster() const { return rasterizer; }
+
+    private:
+        typedef std::chrono::steady_clock clock;
+
+        SoftRaster rasterizer;
+        uint8_t  screen[VIDEO_WIDTH * VIDEO_HEIGHT]{};
+        bool dirty{true};                   // screen changed since the last draw
+        bool fading{};                      // phosphor still glowing
+        clock::time_point last_draw;
+        bool shown{true};                   // text has been written to the terminal
+        bool quit{};
+        bool terminal{};                    // stdin is a tty in raw mode
+        struct termios saved{};
+        clock::time_point pressed[16];
+        std::string text;                   // escape sequences for one frame
+
+        unsigned long draws{};
+        double raster_ms{};
+        unsigned long bytes{};
+};
+
+#endif
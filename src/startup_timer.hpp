@@ -0,0 +1,39 @@
+#ifndef STARTUP_TIMER_HPP
+#define STARTUP_TIMER_HPP
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// breaks cold start time into named stages. Each mark() closes the stage
+// that began at the previous mark (or at construction).
+class StartupTimer {
+    public:
+        StartupTimer() : last(std::chrono::steady_clock::now()), start(last) {}
+
+        void mark(const char *stage){
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            stages.push_back(Stage{ stage, std::chrono::duration<double, std::milli>(now - last).count() });
+            last = now;
+        }
+
+        void report(std::ostream &out) const{
+            out << "startup:\n";
+            for(const Stage &stage : stages){
+                out << "  " << stage.name << std::string(stage.name.size() < 16 ? 16 - stage.name.size() : 1, ' ')
+                    << stage.ms << " ms\n";
+            }
+            out << "  total           " << std::chrono::duration<double, std::milli>(last - start).count() << " ms\n";
+        }
+
+    private:
+        struct Stage {
+            std::string name;
+            double ms;
+        };
+        std::chrono::steady_clock::time_point last;
+        std::chrono::steady_clock::time_point start;
+        std::vector<Stage> stages;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef STATE_HASH_HPP
+#define STATE_HASH_HPP
+#include <cstdint>
+
+// incremental hashing of Chip8 state, cheap enough to keep up to date on
+// every store and drawn pixel:
+//   memory  sum of address_key * byte, so a store adds key * (new - old)
+//   screen  XOR of a Zobrist key per lit pixel, so a flipped pixel XORs its key
+// Cleared memory and a blank screen hash to 0. Chip8 keeps both as it runs;
+// chip8_state.cpp works them out from a snapshot.
+
+// splitmix64's finalizer
+constexpr uint64_t mix64(uint64_t x){
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// random keys, built at compile time
+struct StateHashKeys {
+    uint64_t address[4096];
+    uint64_t pixel[64 * 32];
+    constexpr StateHashKeys() : address(), pixel() {
+        for(int i = 0; i < 4096; i++){
+            address[i] = mix64(i) | 1;  // odd, so no byte difference maps to 0
+        }
+        for(int i = 0; i < 64 * 32; i++){
+            pixel[i] = mix64(0x10000 + i);
+        }
+    }
+};
+extern const StateHashKeys state_hash_keys;   // in chip8.cpp
+
+inline uint64_t memory_delta(uint16_t address, uint8_t from, uint8_t to){
+    return state_hash_keys.address[address] * (uint64_t)((int)to - from);
+}
+
+inline uint64_t pixel_key(int pixel){
+    return state_hash_keys.pixel[pixel];
+}
+
+// the registers, pointers, stack, timers and rng are small enough to hash
+// whole each time, on top of the memory and screen hashes
+inline uint64_t cpu_hash(uint64_t hash, const uint8_t *registers, const uint16_t *stack, uint16_t I, uint16_t pc,
+                         uint8_t sp, uint8_t delay_timer, uint8_t sound_timer, uint32_t rng){
+    for(int i = 0; i < 16; i++){
+        hash = mix64(hash ^ registers[i]);
+    }
+    for(int i = 0; i < 16; i++){
+        hash = mix64(hash ^ stack[i]);
+    }
+    hash = mix64(hash ^ ((uint64_t)I << 48 | (uint64_t)pc << 32 | rng));
+    return mix64(hash ^ (sp | delay_timer << 8 | sound_timer << 16));
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include "state_set.hpp"
+
+StateSet::StateSet(size_t capacity){
+    size_t size = 1;
+    while(size < capacity){
+        size <<= 1;
+    }
+    slots = new std::atomic<uint64_t>[size];
+    for(size_t i = 0; i < size; i++){
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+    mask = size - 1;
+    limit = (size_t)(size * STATE_SET_MAX_LOAD);
+}
+
+StateSet::~StateSet(){
+    delete[] slots;
+}
+
+bool StateSet::insert(uint64_t hash){
+    // 0 is the empty marker, the hashes are mixed well enough to use the
+    // low bits as the slot
+    if(hash == 0){
+        hash = 1;
+    }
+    for(size_t i = hash & mask;; i = (i + 1) & mask){
+        uint64_t seen = slots[i].load(std::memory_order_relaxed);
+        if(seen == hash){
+            return false;
+        }
+        if(seen != 0){
+            continue;
+        }
+        // reserve a place before claiming the slot, so threads racing at
+        // the limit cannot take it past limit
+        if(count.fetch_add(1, std::memory_order_relaxed) >= limit){
+            count.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        if(slots[i].compare_exchange_strong(seen, hash, std::memory_order_relaxed)){
+            return true;
+        }
+        // another thread took the slot first, maybe with the same hash
+        count.fetch_sub(1, std::memory_order_relaxed);
+        if(seen == hash){
+            return false;
+        }
+    }
+}
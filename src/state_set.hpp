@@ -0,0 +1,33 @@
+#ifndef STATE_SET_HPP
+#define STATE_SET_HPP
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// set of 64-bit state hashes that any number of threads insert into at once,
+// without locks: open addressing with linear probing, a slot is claimed with
+// one compare-and-swap. The table never grows, insert() refuses new hashes
+// once it is STATE_SET_MAX_LOAD full so probes stay short.
+#define STATE_SET_MAX_LOAD 0.75
+
+class StateSet {
+    public:
+        explicit StateSet(size_t capacity);     // rounded up to a power of two
+        ~StateSet();
+        StateSet(const StateSet&) = delete;
+        StateSet& operator=(const StateSet&) = delete;
+
+        // true when hash was not in the set and now is
+        bool insert(uint64_t hash);
+        bool full() const { return count.load(std::memory_order_relaxed) >= limit; }
+        size_t size() const { return count.load(std::memory_order_relaxed); }
+        size_t bytes() const { return (mask + 1) * sizeof(uint64_t); }
+
+    private:
+        std::atomic<uint64_t> *slots;   // 0 marks an empty slot
+        size_t mask;
+        size_t limit;
+        std::atomic<size_t> count{};
+};
+
+#endif
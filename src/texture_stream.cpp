@@ -0,0 +1,137 @@
+#include "texture_stream.hpp"
+#include "gl_util.hpp"
+
+// ARB_buffer_storage is not part of the 3.3 core loader, fetch it ourselves
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP PFN_BufferStorage)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+TextureStream::~TextureStream(){
+    if(!tex){
+        return;
+    }
+    for(int i = 0; i < STREAM_RING_SIZE; i++){
+        if(fence[i]){
+            glDeleteSync(fence[i]);
+        }
+    }
+    if(mapped){
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[0]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glDeleteBuffers(mapped ? 1 : STREAM_RING_SIZE, pbo);
+    glDeleteTextures(1, &tex);
+}
+
+bool TextureStream::init(int w, int h, GLADloadproc load){
+    width = w;
+    height = h;
+    frame_size = (size_t)w * h;
+
+    // single channel texture, sampled with nearest filtering
+    glGenTextures(1, &tex);
+    gl_state().bind_texture(0, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // one buffer holding every slot of the ring, mapped for the whole run
+    PFN_BufferStorage bufferStorage = nullptr;
+    if(gl_has_extension("GL_ARB_buffer_storage")){
+        bufferStorage = (PFN_BufferStorage)load("glBufferStorage");
+    }
+    if(bufferStorage){
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[0]);
+        bufferStorage(GL_PIXEL_UNPACK_BUFFER, frame_size * STREAM_RING_SIZE, NULL, flags);
+        mapped = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frame_size * STREAM_RING_SIZE, flags);
+        if(!mapped){
+            glDeleteBuffers(1, pbo);
+        }
+    }
+
+    // fallback: separate buffers orphaned on each upload
+    if(!mapped){
+        glGenBuffers(STREAM_RING_SIZE, pbo);
+        for(int i = 0; i < STREAM_RING_SIZE; i++){
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[i]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, frame_size, NULL, GL_STREAM_DRAW);
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return glGetError() == GL_NO_ERROR;
+}
+
+uint8_t* TextureStream::begin_upload(){
+    started = std::chrono::steady_clock::now();
+    slot = (slot + 1) % STREAM_RING_SIZE;
+
+    if(mapped){
+        // wait until the GPU has finished reading this slot
+        if(fence[slot]){
+            GLenum status = glClientWaitSync(fence[slot], 0, 0);
+            if(status == GL_TIMEOUT_EXPIRED){
+                stalls++;
+                glClientWaitSync(fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            }
+            glDeleteSync(fence[slot]);
+            fence[slot] = 0;
+        }
+        current = mapped + slot * frame_size;
+    }
+    else{
+        // orphan the old storage so the driver never has to wait for it
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[slot]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, frame_size, NULL, GL_STREAM_DRAW);
+        current = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frame_size,
+                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+    return current;
+}
+
+void TextureStream::end_upload(){
+    GLintptr offset = 0;
+    if(mapped){
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[0]);
+        offset = slot * frame_size;
+    }
+    else if(!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)){
+        // contents were lost, skip this frame
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return;
+    }
+
+    gl_state().bind_texture(0, tex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, (void*)offset);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if(mapped){
+        fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    current = nullptr;
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    uploads++;
+    total_ms += ms;
+    if(ms > max_ms){
+        max_ms = ms;
+    }
+}
+
+void TextureStream::report(std::ostream &out) const{
+    out << "texture upload (" << (persistent() ? "persistent" : "orphaned") << " PBO): "
+        << uploads << " uploads";
+    if(uploads){
+        out << ", avg " << total_ms / uploads << " ms, max " << max_ms << " ms, "
+            << stalls << " fence stalls";
+    }
+    out << "\n";
+}
@@ -0,0 +1,42 @@
+#ifndef TEXTURE_STREAM_HPP
+#define TEXTURE_STREAM_HPP
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#define STREAM_RING_SIZE 3
+
+// streams a one byte per pixel image into a texture through a ring of pixel
+// buffer objects. With ARB_buffer_storage the buffers are mapped once and stay
+// mapped, each slot guarded by a fence; otherwise each upload orphans and maps
+// a buffer. The caller writes pixels straight into the returned pointer.
+class TextureStream {
+    public:
+        ~TextureStream();
+        bool init(int width, int height, GLADloadproc load);
+        uint8_t* begin_upload();        // pointer to width * height bytes
+        void end_upload();              // copy the written bytes into the texture
+        unsigned int texture() const { return tex; }
+        bool persistent() const { return mapped != nullptr; }
+        void report(std::ostream &out) const;
+
+    private:
+        int width{}, height{};
+        size_t frame_size{};
+        unsigned int tex{};
+        unsigned int pbo[STREAM_RING_SIZE]{};
+        GLsync fence[STREAM_RING_SIZE]{};
+        uint8_t *mapped{};              // persistent mapping of the whole ring
+        uint8_t *current{};             // slot handed out by begin_upload
+        int slot{};
+
+        // upload cost, measured from begin_upload to end_upload
+        std::chrono::steady_clock::time_point started;
+        unsigned long uploads{};
+        unsigned long stalls{};         // fence was not yet signaled
+        double total_ms{};
+        double max_ms{};
+};
+
+#endif
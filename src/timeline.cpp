@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <chrono>
+
+#include "timeline.hpp"
+
+Timeline::Timeline(Chip8 &chip8, size_t max_bytes, double max_replay_ms, unsigned long interval)
+    : chip8(chip8),
+      max_checkpoints(std::max<size_t>(2, max_bytes / sizeof(Checkpoint))),
+      max_replay_ms(max_replay_ms),
+      interval(std::max(1ul, interval)){
+    checkpoints.push_back(Checkpoint{0, chip8.memory_hash(), chip8.screen_hash(), chip8.state()});
+    apply_keys();
+}
+
+uint16_t Timeline::keys() const{
+    return next_input ? inputs[next_input - 1].keys : 0;
+}
+
+void Timeline::apply_keys(){
+    uint16_t mask = keys();
+    for(int k = 0; k < 16; k++){
+        chip8.key[k] = (mask >> k) & 1;
+    }
+}
+
+void Timeline::set_keys(uint16_t mask){
+    if(mask == keys() && next_input == inputs.size()){
+        return;
+    }
+    // a different input from here on makes the recorded future wrong
+    if(cycle < end){
+        while(checkpoints.back().cycle > cycle){
+            checkpoints.pop_back();
+        }
+        end = cycle;
+    }
+    inputs.resize(next_input);
+    if(!inputs.empty() && inputs.back().cycle == cycle){
+        inputs.back().keys = mask;
+    }
+    else{
+        inputs.push_back(Input{cycle, mask});
+        next_input++;
+    }
+    apply_keys();
+}
+
+void Timeline::load_inputs(const Movie &movie){
+    inputs.clear();
+    uint16_t held = 0;
+    for(const MovieEvent &event : movie.events){
+        if(event.type == 'K'){
+            held ^= event.keys;
+            inputs.push_back(Input{event.cycle, held});
+        }
+    }
+    next_input = 0;
+    while(next_input < inputs.size() && inputs[next_input].cycle <= cycle){
+        next_input++;
+    }
+    apply_keys();
+}
+
+size_t Timeline::checkpoint_before(uint64_t target) const{
+    auto after = std::upper_bound(checkpoints.begin(), checkpoints.end(), target,
+                                  [](uint64_t c, const Checkpoint &checkpoint){ return c < checkpoint.cycle; });
+    return (size_t)(after - checkpoints.begin()) - 1;
+}
+
+void Timeline::restore(const Checkpoint &checkpoint){
+    chip8.restore(checkpoint.state, checkpoint.memory, checkpoint.screen);
+    cycle = checkpoint.cycle;
+    next_input = std::upper_bound(inputs.begin(), inputs.end(), cycle,
+                                  [](uint64_t c, const Input &input){ return c < input.cycle; }) - inputs.begin();
+    apply_keys();
+}
+
+void Timeline::checkpoint(){
+    if(checkpoints.size() >= max_checkpoints){
+        thin();
+        if(cycle - checkpoints.back().cycle < interval){
+            return;
+        }
+    }
+    checkpoints.push_back(Checkpoint{cycle, chip8.memory_hash(), chip8.screen_hash(), chip8.state()});
+}
+
+void Timeline::thin(){
+    // doubling keeps all of history while a step back stays within the bound
+    double rate = timed_seconds > 0 ? timed_cycles / timed_seconds : 0;
+    if(rate == 0 || interval * 2 <= rate * max_replay_ms / 1000){
+        size_t kept = 0;
+        for(size_t i = 0; i < checkpoints.size(); i++){
+            if(i % 2 == 0){
+                if(kept != i){
+                    checkpoints[kept] = checkpoints[i];
+                }
+                kept++;
+            }
+        }
+        checkpoints.resize(kept);
+        interval *= 2;
+        thinned++;
+    }
+    else{
+        checkpoints.pop_front();
+        dropped++;
+    }
+}
+
+bool Timeline::run(uint64_t target, bool check){
+    auto last = std::chrono::steady_clock::now();
+    bool hit = false;
+    while(cycle < target && !hit){
+        if(cycle == end && cycle - checkpoints.back().cycle >= interval){
+            checkpoint();
+        }
+        while(next_input < inputs.size() && inputs[next_input].cycle <= cycle){
+            next_input++;
+        }
+        apply_keys();
+
+        // up to the next key change, or the next checkpoint past the frontier
+        uint64_t stop = std::min(target, cycle < end ? end : checkpoints.back().cycle + interval);
+        if(next_input < inputs.size()){
+            stop = std::min(stop, inputs[next_input].cycle);
+        }
+        uint64_t from = cycle;
+        if(check){
+            while(cycle < stop){
+                chip8.cycle();
+                cycle++;
+                if(breakpoints[chip8.program_counter() & 0xFFF]){
+                    hit = true;
+                    break;
+                }
+            }
+        }
+        else{
+            for(uint64_t n = stop - cycle; n; n--){
+                chip8.cycle();
+            }
+            cycle = stop;
+        }
+        end = std::max(end, cycle);
+
+        // timed per stretch so a long first run already bounds the interval
+        auto now = std::chrono::steady_clock::now();
+        timed_cycles += cycle - from;
+        timed_seconds += std::chrono::duration<double>(now - last).count();
+        last = now;
+    }
+    return hit;
+}
+
+bool Timeline::seek(uint64_t target){
+    bool clamped = target < oldest();
+    if(clamped){
+        target = oldest();
+    }
+    const Checkpoint &nearest = checkpoints[checkpoint_before(target)];
+    if(target < cycle || nearest.cycle > cycle){
+        restore(nearest);
+        if(target < end){
+            replayed += target - cycle;
+        }
+    }
+    run(target, false);
+    return !clamped;
+}
+
+bool Timeline::resume(uint64_t limit){
+    return run(cycle + limit, true);
+}
+
+bool Timeline::reverse_resume(){
+    uint64_t from = cycle;
+    if(from <= oldest()){
+        return false;
+    }
+    // latest segment first; within one the last hit before from wins
+    for(size_t i = checkpoint_before(from - 1);; i--){
+        uint64_t stop = i + 1 < checkpoints.size() ? std::min(checkpoints[i + 1].cycle, from) : from;
+        restore(checkpoints[i]);
+        bool found = breakpoints[chip8.program_counter() & 0xFFF];
+        uint64_t last = cycle;
+        while(cycle < stop){
+            if(run(stop, true) && cycle < stop){
+                found = true;
+                last = cycle;
+            }
+        }
+        replayed += stop - checkpoints[i].cycle;
+        if(found){
+            seek(last);
+            return true;
+        }
+        if(i == 0){
+            seek(from);
+            return false;
+        }
+    }
+}
+
+void Timeline::report(std::ostream &out) const{
+    double rate = timed_seconds > 0 ? timed_cycles / timed_seconds : 0;
+    out << checkpoints.size() << " checkpoints (" << checkpoints.size() * sizeof(Checkpoint) / 1024 << " KB of "
+        << max_checkpoints * sizeof(Checkpoint) / 1024 << " KB) every " << interval << " instructions, history "
+        << oldest() << " to " << end << "\n"
+        << "interval doubled " << thinned << " times, " << dropped << " oldest checkpoints dropped, "
+        << inputs.size() << " key changes logged\n"
+        << rate / 1e6 << " M instructions/s, a step back re-runs up to " << interval << " instructions ("
+        << (rate > 0 ? interval / rate * 1000 : 0) << " ms), " << replayed << " re-run so far\n";
+}
@@ -0,0 +1,92 @@
+#ifndef TIMELINE_HPP
+#define TIMELINE_HPP
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "chip8.hpp"
+#include "movie.hpp"
+
+#define TIMELINE_INTERVAL 1000          // instructions between checkpoints to start with
+#define TIMELINE_MAX_BYTES (64ul << 20) // checkpoints kept, about 12 KB each
+#define TIMELINE_MAX_REPLAY_MS 10.0     // re-execution allowed for one step back
+
+// a run of a Chip8 that can be moved to any instruction in its past. The
+// machine is checkpointed every interval instructions and every key change
+// is logged, so going back restores the nearest checkpoint before the target
+// and runs forward again, which gives the same states since execution is
+// deterministic given the seed and keys.
+// The interval adapts. When the checkpoints fill their memory budget every
+// other one is dropped and the interval doubles, until re-executing an
+// interval would take longer than the replay bound at the measured speed;
+// after that the oldest checkpoints go, and history before them is lost.
+class Timeline {
+    public:
+        // takes over a freshly loaded and seeded machine
+        Timeline(Chip8 &chip8, size_t max_bytes = TIMELINE_MAX_BYTES,
+                 double max_replay_ms = TIMELINE_MAX_REPLAY_MS, unsigned long interval = TIMELINE_INTERVAL);
+
+        uint64_t now() const { return cycle; }
+        uint64_t oldest() const { return checkpoints.front().cycle; }   // earliest reachable instruction
+        uint64_t frontier() const { return end; }                       // furthest one run so far
+        uint16_t keys() const;          // held while the instruction at now() runs
+
+        // holds keys from now() on. In the past this rewrites history, so
+        // the states and inputs after now() are dropped.
+        void set_keys(uint16_t mask);
+        // the key changes of a recorded movie, replayed as the run goes
+        void load_inputs(const Movie &movie);
+
+        void breakpoint(uint16_t address, bool on) { breakpoints[address & 0xFFF] = on; }
+        bool breakpoint(uint16_t address) const { return breakpoints[address & 0xFFF]; }
+
+        // moves to instruction target, clamped to oldest(); false if clamped
+        bool seek(uint64_t target);
+        // runs until pc is on a breakpoint, at most limit instructions;
+        // true if it stopped on one
+        bool resume(uint64_t limit);
+        // moves to the last instruction before now() that starts on a
+        // breakpoint; false, without moving, if there is none in history
+        bool reverse_resume();
+
+        void report(std::ostream &out) const;
+
+    private:
+        struct Checkpoint {
+            uint64_t cycle;
+            uint64_t memory, screen;    // hashes restore() can skip
+            Chip8State state;
+        };
+        struct Input {
+            uint64_t cycle;
+            uint16_t keys;
+        };
+
+        // forward to target, checkpointing at the frontier; stops early on a
+        // breakpoint after the first instruction if check is set
+        bool run(uint64_t target, bool check);
+        void restore(const Checkpoint &checkpoint);
+        void checkpoint();
+        void thin();
+        size_t checkpoint_before(uint64_t target) const;   // last one at or before it
+        void apply_keys();
+
+        Chip8 &chip8;
+        uint64_t cycle{}, end{};
+        std::deque<Checkpoint> checkpoints;
+        std::vector<Input> inputs;      // by cycle, each the mask from then on
+        size_t next_input{};            // first input after now()
+        bool breakpoints[4096]{};
+
+        size_t max_checkpoints;
+        double max_replay_ms;
+        unsigned long interval;
+        unsigned long thinned{}, dropped{};
+        // execution speed, for the replay bound
+        uint64_t timed_cycles{};
+        double timed_seconds{};
+        uint64_t replayed{};            // instructions run again to move back
+};
+
+#endif
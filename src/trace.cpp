@@ -0,0 +1,133 @@
+#ifndef CHIP8_NO_TRACE
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+// events this close to the oldest are skipped while the ring has wrapped,
+// their owner may be overwriting them as the file is written
+#define TRACE_FLUSH_MARGIN 1024
+
+struct TraceEvent {
+    const char *name;
+    uint64_t start, end;
+    uint32_t count;                     // written as an argument when not 0
+};
+
+// written by its thread only; kept after the thread exits so its events
+// still make it into the file
+struct TraceBuffer {
+    int tid{};
+    const char *name{};
+    std::atomic<uint64_t> written{};
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+};
+
+std::atomic<bool> trace_on{false};
+static std::atomic<bool> flush_requested{false};
+static std::chrono::steady_clock::time_point origin;
+static std::string trace_path;
+static std::mutex buffers_lock;         // taken once per thread and when writing
+static std::vector<TraceBuffer*> buffers;
+static thread_local TraceBuffer *local;
+
+static TraceBuffer* thread_buffer(){
+    if(!local){
+        local = new TraceBuffer();
+        std::lock_guard<std::mutex> guard(buffers_lock);
+        local->tid = (int)buffers.size() + 1;
+        buffers.push_back(local);
+    }
+    return local;
+}
+
+static void on_signal(int){
+    flush_requested.store(true);
+}
+
+static bool write_trace(){
+    std::string temporary = trace_path + ".tmp";
+    FILE *out = std::fopen(temporary.c_str(), "w");
+    if(!out){
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(buffers_lock);
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", out);
+    bool first = true;
+    unsigned long events = 0;
+    for(TraceBuffer *buffer : buffers){
+        if(buffer->name){
+            std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                         first ? "" : ",\n", buffer->tid, buffer->name);
+            first = false;
+        }
+        uint64_t end = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = end > TRACE_BUFFER_EVENTS ? end - TRACE_BUFFER_EVENTS + TRACE_FLUSH_MARGIN : 0;
+        for(uint64_t i = begin; i < end; i++){
+            const TraceEvent &event = buffer->events[i % TRACE_BUFFER_EVENTS];
+            std::fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                         first ? "" : ",\n", event.name, buffer->tid, event.start / 1e3, (event.end - event.start) / 1e3);
+            if(event.count){
+                std::fprintf(out, ",\"args\":{\"count\":%u}", event.count);
+            }
+            std::fputs("}", out);
+            first = false;
+        }
+        events += end - begin;
+    }
+    std::fputs("\n]}\n", out);
+    bool ok = std::fclose(out) == 0 && std::rename(temporary.c_str(), trace_path.c_str()) == 0;
+    if(ok){
+        std::cout << "trace: " << events << " events written to " << trace_path << std::endl;
+    }
+    return ok;
+}
+
+bool trace_start(const char *path){
+    trace_path = path;
+    origin = std::chrono::steady_clock::now();
+    std::signal(SIGUSR1, on_signal);
+    trace_on.store(true);
+    return true;
+}
+
+void trace_poll(){
+    if(flush_requested.load(std::memory_order_relaxed) && flush_requested.exchange(false)){
+        if(!write_trace()){
+            std::cerr << "ERROR::TRACE::WRITE_FAILED " << trace_path << std::endl;
+        }
+    }
+}
+
+void trace_stop(){
+    if(!trace_on.exchange(false)){
+        return;
+    }
+    if(!write_trace()){
+        std::cerr << "ERROR::TRACE::WRITE_FAILED " << trace_path << std::endl;
+    }
+}
+
+void trace_thread_name(const char *name){
+    if(trace_on.load(std::memory_order_relaxed)){
+        thread_buffer()->name = name;
+    }
+}
+
+uint64_t trace_now(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void trace_event(const char *name, uint64_t start, uint64_t end, uint32_t count){
+    TraceBuffer *buffer = thread_buffer();
+    uint64_t n = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[n % TRACE_BUFFER_EVENTS] = TraceEvent{ name, start, end, count };
+    buffer->written.store(n + 1, std::memory_order_release);
+}
+
+#endif
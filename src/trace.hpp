@@ -0,0 +1,101 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+#include <atomic>
+#include <cstdint>
+
+#define TRACE_BUFFER_EVENTS 65536       // per thread; the oldest are overwritten
+
+// timeline of named scopes written as Chrome trace JSON, which
+// chrome://tracing and ui.perfetto.dev both open. Each thread appends to its
+// own ring without locks; the file is written on exit and whenever SIGUSR1
+// arrives, holding the last TRACE_BUFFER_EVENTS events of every thread.
+// With tracing off at runtime a scope costs one relaxed load, and building
+// with -DCHIP8_NO_TRACE removes the scopes entirely.
+#ifndef CHIP8_NO_TRACE
+
+bool trace_start(const char *path);     // start recording, flushed to path
+void trace_poll();                      // from the main loop: write the file if SIGUSR1 asked
+void trace_stop();                      // write the file and stop recording
+void trace_thread_name(const char *name);
+
+extern std::atomic<bool> trace_on;
+
+uint64_t trace_now();                   // nanoseconds since trace_start
+void trace_event(const char *name, uint64_t start, uint64_t end, uint32_t count = 0);
+
+inline bool trace_enabled(){
+    return trace_on.load(std::memory_order_relaxed);
+}
+
+// records the time between construction and destruction; name must be a
+// string literal, it is written out long after the scope is gone
+class TraceScope {
+    public:
+        TraceScope(const char *scope_name){
+            if(trace_on.load(std::memory_order_relaxed)){
+                name = scope_name;
+                start = trace_now();
+            }
+        }
+        ~TraceScope(){
+            if(name){
+                trace_event(name, start, trace_now());
+            }
+        }
+
+    private:
+        const char *name{};
+        uint64_t start{};
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+// policy for Chip8::step() that records each run of consecutive DXYN
+// instructions as one "DXYN burst" event counting the draws; one event per
+// draw would overwrite the whole ring within a few frames. Call flush() at
+// the end of a batch so a burst does not span two.
+class TraceDrawBursts {
+    public:
+        void instruction(uint16_t, uint16_t opcode, uint16_t){
+            if((opcode & 0xF000u) == 0xD000u){
+                if(!draws){
+                    start = trace_now();
+                }
+                draws++;
+            }
+            else{
+                flush();
+            }
+        }
+        void flush(){
+            if(draws){
+                trace_event("DXYN burst", start, trace_now(), draws);
+                draws = 0;
+            }
+        }
+
+    private:
+        uint64_t start{};
+        uint32_t draws{};
+};
+
+#else
+
+inline bool trace_start(const char*) { return false; }
+inline void trace_poll() {}
+inline void trace_stop() {}
+inline void trace_thread_name(const char*) {}
+inline bool trace_enabled() { return false; }
+
+struct TraceDrawBursts {
+    void instruction(uint16_t, uint16_t, uint16_t) {}
+    void flush() {}
+};
+
+#define TRACE_SCOPE(name)
+
+#endif
+
+#endif
@@ -0,0 +1,225 @@
+#include <unistd.h>
+#include <cstring>
+
+#include "video_writer.hpp"
+#include "png_writer.hpp"
+#include "trace.hpp"
+
+bool frame_pattern(const std::string &path){
+    int numbers = 0;
+    for(size_t i = 0; i < path.size(); i++){
+        if(path[i] != '%'){
+            continue;
+        }
+        if(++i < path.size() && path[i] == '%'){
+            continue;
+        }
+        while(i < path.size() && path[i] >= '0' && path[i] <= '9'){
+            i++;
+        }
+        if(i == path.size() || path[i] != 'd'){
+            return false;
+        }
+        numbers++;
+    }
+    return numbers == 1;
+}
+
+VideoWriter::~VideoWriter(){
+    close();
+}
+
+bool VideoWriter::open(const std::string &target, int w, int h){
+    path = target;
+    width = w;
+    height = h;
+    y4m = path.size() > 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+    if(y4m){
+        file = std::fopen(path.c_str(), "wb");
+        if(!file){
+            return false;
+        }
+        // 4:4:4 keeps single pixel detail that chroma subsampling would smear
+        std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, VIDEO_FPS);
+    }
+    else if(!frame_pattern(path)){
+        return false;
+    }
+    for(Frame &frame : ring){
+        frame.pixels.resize((size_t)width * height);
+    }
+    thread = std::thread(&VideoWriter::run, this);
+    return true;
+}
+
+uint32_t* VideoWriter::begin_frame(){
+    std::unique_lock<std::mutex> guard(lock);
+    if(produced - consumed == VIDEO_RING_SIZE){
+        stalls++;
+        not_full.wait(guard, [this]{ return produced - consumed < VIDEO_RING_SIZE; });
+    }
+    return ring[produced % VIDEO_RING_SIZE].pixels.data();
+}
+
+void VideoWriter::end_frame(){
+    submit(false);
+}
+
+void VideoWriter::repeat_frame(){
+    begin_frame();
+    repeats++;
+    submit(true);
+}
+
+void VideoWriter::submit(bool repeat){
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Frame &frame = ring[produced % VIDEO_RING_SIZE];
+        frame.rows = nullptr;
+        frame.repeat = repeat;
+        frame.copies = 0;
+        produced++;
+    }
+    not_empty.notify_one();
+}
+
+bool VideoWriter::submit_rows(const uint8_t *rows, int copies, bool wait, unsigned long &ticket){
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        if(produced - consumed == VIDEO_RING_SIZE){
+            if(!wait){
+                return false;
+            }
+            stalls++;
+            not_full.wait(guard, [this]{ return produced - consumed < VIDEO_RING_SIZE; });
+        }
+        Frame &frame = ring[produced % VIDEO_RING_SIZE];
+        frame.rows = rows;
+        frame.repeat = false;
+        frame.copies = copies;
+        repeats += copies;
+        ticket = produced++;
+    }
+    not_empty.notify_one();
+    return true;
+}
+
+bool VideoWriter::released(unsigned long ticket){
+    std::lock_guard<std::mutex> guard(lock);
+    return copied > ticket;
+}
+
+void VideoWriter::wait_released(unsigned long ticket){
+    std::unique_lock<std::mutex> guard(lock);
+    rows_read.wait(guard, [this, ticket]{ return copied > ticket; });
+}
+
+void VideoWriter::close(){
+    if(!thread.joinable()){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closing = true;
+    }
+    not_empty.notify_one();
+    thread.join();
+    if(file){
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+void VideoWriter::run(){
+    trace_thread_name("video writer");
+    std::unique_lock<std::mutex> guard(lock);
+    for(;;){
+        not_empty.wait(guard, [this]{ return produced != consumed || closing; });
+        if(produced == consumed){
+            return;
+        }
+        // the producer never touches a slot until it has been consumed
+        Frame &frame = ring[consumed % VIDEO_RING_SIZE];
+        guard.unlock();
+        if(frame.rows){
+            // GL returns rows bottom up; flipping here keeps the copy off the render thread
+            TRACE_SCOPE("flip");
+            size_t row = (size_t)width * 4;
+            for(int y = 0; y < height; y++){
+                std::memcpy(frame.pixels.data() + (size_t)y * width, frame.rows + (height - 1 - y) * row, row);
+            }
+        }
+        guard.lock();
+        copied = consumed + 1;
+        guard.unlock();
+        rows_read.notify_all();
+        for(int copy = 0; copy <= frame.copies && !failed; copy++){
+            TRACE_SCOPE("encode");
+            bool repeat = frame.repeat || copy > 0;
+            failed = !(y4m ? write_y4m(frame, repeat) : write_png_frame(frame, repeat));
+            if(failed){
+                std::cerr << "ERROR::VIDEO::WRITE_FAILED " << path << std::endl;
+            }
+        }
+        guard.lock();
+        consumed++;
+        not_full.notify_one();
+    }
+}
+
+bool VideoWriter::write_y4m(const Frame &frame, bool repeat){
+    files++;
+    if(!repeat || encoded.empty()){
+        // BT.601 studio range; emulator frames hold few colors, so remember the last one
+        const size_t plane = (size_t)width * height;
+        encoded.resize(plane * 3);
+        uint8_t *y = encoded.data(), *u = y + plane, *v = u + plane;
+        uint32_t last = ~frame.pixels[0];
+        uint8_t ly = 0, lu = 0, lv = 0;
+        for(size_t i = 0; i < plane; i++){
+            uint32_t p = frame.pixels[i];
+            if(p != last){
+                int r = p & 0xFF, g = (p >> 8) & 0xFF, b = (p >> 16) & 0xFF;
+                ly = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                lu = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                lv = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+                last = p;
+            }
+            y[i] = ly;
+            u[i] = lu;
+            v[i] = lv;
+        }
+    }
+    bytes += encoded.size() + 6;
+    return std::fputs("FRAME\n", file) >= 0 &&
+           std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+}
+
+bool VideoWriter::write_png_frame(const Frame &frame, bool repeat){
+    // the pattern passed frame_pattern(): one %d and nothing else to expand
+    char name[4096];
+    std::snprintf(name, sizeof(name), path.c_str(), (int)files++);
+    if(repeat && !last_file.empty()){
+        // same picture: link to the previous file, or write its bytes again
+        unlink(name);
+        if(link(last_file.c_str(), name) == 0){
+            return true;
+        }
+    }
+    else{
+        encode_png(frame.pixels.data(), width, height, encoded);
+    }
+    last_file = name;
+    FILE *out = std::fopen(name, "wb");
+    if(!out){
+        return false;
+    }
+    bool ok = std::fwrite(encoded.data(), 1, encoded.size(), out) == encoded.size();
+    bytes += encoded.size();
+    return std::fclose(out) == 0 && ok;
+}
+
+void VideoWriter::report(std::ostream &out) const{
+    out << "video: " << files << " frames (" << repeats << " repeated) to " << path << ", "
+        << bytes / (1024 * 1024) << " MiB written, " << stalls << " writer stalls\n";
+}
@@ -0,0 +1,82 @@
+#ifndef VIDEO_WRITER_HPP
+#define VIDEO_WRITER_HPP
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define VIDEO_RING_SIZE 8
+#define VIDEO_FPS 60
+
+// writes RGBA frames to a Y4M file or a numbered PNG sequence on a
+// background thread. Frames are handed over through a bounded ring, so the
+// producer only waits when the writer is a whole ring behind. A repeated
+// frame costs no copy: Y4M gets the previous frame's bytes again and a PNG
+// sequence gets a hard link to the previous file.
+// true if path is a frame pattern VideoWriter can number safely: exactly one
+// %d, optionally zero padded to a width as in %05d, and no other conversion
+// apart from %%
+bool frame_pattern(const std::string &path);
+
+class VideoWriter {
+    public:
+        ~VideoWriter();
+        // path ending in .y4m, or a frame_pattern() such as frames/%05d.png
+        bool open(const std::string &path, int width, int height);
+        uint32_t* begin_frame();        // width * height pixels to fill
+        void end_frame();
+        void repeat_frame();            // same picture as the last frame
+        // hands over a frame in GL's bottom up row order, followed by repeats
+        // copies of it. The writer thread flips the rows into its ring, so rows
+        // must stay valid until released(ticket). Without wait it returns
+        // false rather than block when the ring is full.
+        bool submit_rows(const uint8_t *rows, int repeats, bool wait, unsigned long &ticket);
+        bool released(unsigned long ticket);
+        void wait_released(unsigned long ticket);
+        void close();                   // drain the ring and stop the thread
+        void report(std::ostream &out) const;
+
+    private:
+        struct Frame {
+            std::vector<uint32_t> pixels;
+            const uint8_t *rows{};      // bottom up, still to be copied into pixels
+            bool repeat{};
+            int copies{};               // repeats that follow it
+        };
+
+        void run();
+        void submit(bool repeat);
+        bool write_y4m(const Frame &frame, bool repeat);
+        bool write_png_frame(const Frame &frame, bool repeat);
+
+        std::string path;
+        bool y4m{};
+        FILE *file{};
+        int width{}, height{};
+        Frame ring[VIDEO_RING_SIZE];
+        unsigned long produced{};       // frames handed over
+        unsigned long consumed{};       // frames written
+        unsigned long copied{};         // frames whose rows were read
+        bool closing{};
+        std::mutex lock;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+        std::condition_variable rows_read;
+        std::thread thread;
+
+        // writer thread only
+        std::vector<uint8_t> encoded;   // last frame as written
+        std::string last_file;
+        unsigned long files{};          // frames written, repeats included
+        bool failed{};
+
+        unsigned long repeats{};
+        unsigned long stalls{};         // begin_frame waited for the writer
+        unsigned long long bytes{};
+};
+
+#endif